@@ -28,21 +28,143 @@
 #define __BDI_COMPRESSOR_HH__
 
 #include "common.hh"
-bool sign_extended(UINT64 value, UINT8 bit_size) {
-    UINT64 max = (1ULL << (bit_size-1)) - 1;    // bit_size: 4 -> ...00000111
-    UINT64 min = ~max;                          // bit_size: 4 -> ...11111000
-    return (value <= max) | (value >= min);
+//------------------------------------------------------------------------------
+// BDI encoding of a line in one vector pass (same result as the cascade in
+// BDICompressorQW::getEncodingCascade)
+//   immediate : qword sign-extends from n bits / dword, word <= 2^(n-1)-1
+//   base      : first element that is not an immediate
+//   fits      : every non-immediate element is base + n-bit signed delta
+// Deltas are taken at the element width. For dwords/words that is exact:
+// both operands are non-immediates, so |delta| stays below 2^w - 2^(n-1).
+// define BDI_NO_SIMD to always use the cascade
+#if (defined(__x86_64__) || defined(__i386__)) && ((LSIZE%256)==0) && !defined(BDI_NO_SIMD)
+#define BDI_SIMD
+#include <immintrin.h>
+#endif
+
+typedef int (*BDI_CLASSIFY_FUNC)(CACHELINE_DATA *line);
+
+#ifdef BDI_SIMD
+#define BDI_YMM_PER_LINE    (_MAX_BYTES_PER_LINE/32)
+
+// imm: per-lane immediate masks, returns the byte offset of the base or -1
+__attribute__((target("avx2")))
+static inline int bdi_find_base(const __m256i *imm) {
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        UINT32 nonImm = ~((UINT32) _mm256_movemask_epi8(imm[k]));
+        if (nonImm!=0) {
+            return k*32 + __builtin_ctz(nonImm);
+        }
+    }
+    return -1;
+}
+
+template <int BITS>
+__attribute__((target("avx2")))
+static inline bool bdi_fits_qword_avx2(const __m256i *v, const CACHELINE_DATA *line) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i half = _mm256_set1_epi64x(1ll<<(BITS-1));
+    __m256i imm[BDI_YMM_PER_LINE];
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        imm[k] = _mm256_cmpeq_epi64(_mm256_srli_epi64(_mm256_add_epi64(v[k], half), BITS), zero);
+    }
+    int base = bdi_find_base(imm);
+    if (base<0) {
+        return true;
+    }
+    __m256i offset = _mm256_sub_epi64(half, _mm256_set1_epi64x(line->qword[base/8]));
+    __m256i ok = _mm256_cmpeq_epi64(zero, zero);
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        __m256i fit = _mm256_cmpeq_epi64(_mm256_srli_epi64(_mm256_add_epi64(v[k], offset), BITS), zero);
+        ok = _mm256_and_si256(ok, _mm256_or_si256(imm[k], fit));
+    }
+    return ((UINT32) _mm256_movemask_epi8(ok))==0xFFFFFFFFu;
+}
+
+template <int BITS>
+__attribute__((target("avx2")))
+static inline bool bdi_fits_dword_avx2(const __m256i *v, const CACHELINE_DATA *line) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i imm[BDI_YMM_PER_LINE];
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        imm[k] = _mm256_cmpeq_epi32(_mm256_srli_epi32(v[k], BITS-1), zero);
+    }
+    int base = bdi_find_base(imm);
+    if (base<0) {
+        return true;
+    }
+    __m256i offset = _mm256_sub_epi32(_mm256_set1_epi32(1<<(BITS-1)), _mm256_set1_epi32(line->dword[base/4]));
+    __m256i ok = _mm256_cmpeq_epi32(zero, zero);
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        __m256i fit = _mm256_cmpeq_epi32(_mm256_srli_epi32(_mm256_add_epi32(v[k], offset), BITS), zero);
+        ok = _mm256_and_si256(ok, _mm256_or_si256(imm[k], fit));
+    }
+    return ((UINT32) _mm256_movemask_epi8(ok))==0xFFFFFFFFu;
+}
+
+template <int BITS>
+__attribute__((target("avx2")))
+static inline bool bdi_fits_word_avx2(const __m256i *v, const CACHELINE_DATA *line) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i imm[BDI_YMM_PER_LINE];
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        imm[k] = _mm256_cmpeq_epi16(_mm256_srli_epi16(v[k], BITS-1), zero);
+    }
+    int base = bdi_find_base(imm);
+    if (base<0) {
+        return true;
+    }
+    __m256i offset = _mm256_sub_epi16(_mm256_set1_epi16(1<<(BITS-1)), _mm256_set1_epi16(line->word[base/2]));
+    __m256i ok = _mm256_cmpeq_epi16(zero, zero);
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        __m256i fit = _mm256_cmpeq_epi16(_mm256_srli_epi16(_mm256_add_epi16(v[k], offset), BITS), zero);
+        ok = _mm256_and_si256(ok, _mm256_or_si256(imm[k], fit));
+    }
+    return ((UINT32) _mm256_movemask_epi8(ok))==0xFFFFFFFFu;
+}
+
+__attribute__((target("avx2")))
+static int bdi_classify_avx2(CACHELINE_DATA *line) {
+    __m256i v[BDI_YMM_PER_LINE];
+    __m256i first = _mm256_set1_epi64x(line->qword[0]);
+    __m256i nonZero = _mm256_setzero_si256();
+    __m256i nonRep = _mm256_setzero_si256();
+    for (int k=0; k<BDI_YMM_PER_LINE; k++) {
+        v[k] = _mm256_loadu_si256((const __m256i *) &line->byte[k*32]);
+        nonZero = _mm256_or_si256(nonZero, v[k]);
+        nonRep = _mm256_or_si256(nonRep, _mm256_xor_si256(v[k], first));
+    }
+    if (_mm256_testz_si256(nonZero, nonZero))       return 0x0;
+    else if (_mm256_testz_si256(nonRep, nonRep))    return 0x1;
+    else if (bdi_fits_qword_avx2<8>(v, line))       return 0x2;
+    else if (bdi_fits_dword_avx2<8>(v, line))       return 0x5;
+    else if (bdi_fits_qword_avx2<16>(v, line))      return 0x3;
+    else if (bdi_fits_dword_avx2<16>(v, line))      return 0x6;
+    else if (bdi_fits_word_avx2<8>(v, line))        return 0x7;
+    else if (bdi_fits_qword_avx2<32>(v, line))      return 0x4;
+    else                                            return 0xf;
 }
+#endif
 
-bool zero_extended(UINT64 value, UINT8 bit_size) {
-    UINT64 max = (1ULL << (bit_size)) - 1;      // bit_size: 4 -> ...00001111
-    return (value <= max);
+static BDI_CLASSIFY_FUNC bdi_select_classify() {
+#ifdef BDI_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return bdi_classify_avx2;
+    }
+#endif
+    return NULL;
 }
 
+// NULL if no vector kernel is usable -> BDICompressorQW keeps the cascade
+static BDI_CLASSIFY_FUNC bdi_classify = bdi_select_classify();
+
 class BDCompressorQW : public Compressor {
 public:
     BDCompressorQW(): Compressor("BD-QW") {}
     BDCompressorQW(string name): Compressor(name) {}
+    Compressor *clone() const { return new BDCompressorQW(*this); }
+    COMPRESS_LINES(BDCompressorQW)
 
     // external interface
 public:
@@ -172,78 +294,179 @@ protected:
 class BDICompressorQW : public BDCompressorQW {
 public:
     BDICompressorQW(): BDCompressorQW("BDI-QW") {}
+    Compressor *clone() const { return new BDICompressorQW(*this); }
+    COMPRESS_LINES(BDICompressorQW)
 
     // external interface
 public:
     LENGTH compressLine(CACHELINE_DATA *line, UINT64 line_addr) {
         LENGTH blkLength;
+        int encoding = getEncoding(line);
 
-        // 0000: zeros
-        // : one byte for 32-byte line / one byte for 64-byte line / one byte for 128-byte line
-        if (zero(line)) {
-            countPattern(0);
-            blkLength = 8*1+4;
-        }
-        // 0001: repeated 64-bit
-        // : 8 bytes for 32-byte line / 8 bytes for 64-byte line / 8 byte for 128-byte line
-        else if (rep_qword(line)) {
-            countPattern(1);
-            blkLength = 8*8+4;
-        }
-        // 0010: base8 + delta1
-        // 12.5 bytes for 32-byte line / 17-bytes for 64-byte line; / 26 bytes for 128-byte line
-        else if (BDI_qword(line, 1)) {
-            countPattern(2);
-            blkLength = 8*24+16+4;
+        switch (encoding) {
+            // 0000: zeros
+            // : one byte for 32-byte line / one byte for 64-byte line / one byte for 128-byte line
+            case 0x0: blkLength = 8*1+4;         break;
+            // 0001: repeated 64-bit
+            // : 8 bytes for 32-byte line / 8 bytes for 64-byte line / 8 byte for 128-byte line
+            case 0x1: blkLength = 8*8+4;         break;
+            // 0010: base8 + delta1
+            // 12.5 bytes for 32-byte line / 17-bytes for 64-byte line; / 26 bytes for 128-byte line
+            case 0x2: blkLength = 8*24+16+4;     break;
             //updateLength(8*(8 + _MAX_QWORDS_PER_LINE*1)+_MAX_QWORDS_PER_LINE+4, minLength, 0x2, minPattern);
-        }
-        // 0101: base4 + delta1
-        // 13 bytes for 32-byte line / 22 bytes for 64-byte line / 40 bytes for 128-byte line
-        else if (BDI_dword(line, 1)) {
-            countPattern(5);
-            blkLength = 8*36+32+4;
+            // 0101: base4 + delta1
+            // 13 bytes for 32-byte line / 22 bytes for 64-byte line / 40 bytes for 128-byte line
+            case 0x5: blkLength = 8*36+32+4;     break;
             //updateLength(8*(4 + _MAX_DWORDS_PER_LINE*1)+_MAX_DWORDS_PER_LINE+4, minLength, 0x5, minPattern);
-        }
-        // 0011: base8 + delta2
-        // 16.5 bytes for 32-byte line / 25-bytes for 64-byte line / 42-bytes for 128-byte line
-        else if (BDI_qword(line, 2)) {
-            countPattern(3);
-            blkLength = 8*40+16+4;
+            // 0011: base8 + delta2
+            // 16.5 bytes for 32-byte line / 25-bytes for 64-byte line / 42-bytes for 128-byte line
+            case 0x3: blkLength = 8*40+16+4;     break;
             //updateLength(8*(8 + _MAX_QWORDS_PER_LINE*2)+_MAX_QWORDS_PER_LINE+4, minLength, 0x3, minPattern);
-        }
-        // 0110: base4 + delta2
-        // 21 bytes for 32-byte line / 38 bytes for 64-byte line / 72 bytes for 128-byte line
-        else if (BDI_dword(line, 2)) {
-            countPattern(6);
-            blkLength = 8*68+32+4;
+            // 0110: base4 + delta2
+            // 21 bytes for 32-byte line / 38 bytes for 64-byte line / 72 bytes for 128-byte line
+            case 0x6: blkLength = 8*68+32+4;     break;
             //updateLength(8*(4 + _MAX_DWORDS_PER_LINE*2)+_MAX_DWORDS_PER_LINE+4, minLength, 0x6, minPattern);
-        }
-        // 0111: base2 + delta1
-        // 20 bytes for 32-byte line / 38 bytes for 64-byte line / 74 bytes for 128-byte line
-        else if (BDI_word(line, 1)) {
-            countPattern(7);
-            blkLength = 8*66+64+4;
+            // 0111: base2 + delta1
+            // 20 bytes for 32-byte line / 38 bytes for 64-byte line / 74 bytes for 128-byte line
+            case 0x7: blkLength = 8*66+64+4;     break;
             //updateLength(8*(2 + _MAX_WORDS_PER_LINE*1)+_MAX_WORDS_PER_LINE+4, minLength, 0x7, minPattern);
-        }
-        // 0100: base8 + delta4
-        // 24.5 bytes for 32-byte line / 41 bytes for 64-byte line / 74 bytes for 128-byte line
-        else if (BDI_qword(line, 4)) {
-            countPattern(4);
-            blkLength = 8*72+16+4;
+            // 0100: base8 + delta4
+            // 24.5 bytes for 32-byte line / 41 bytes for 64-byte line / 74 bytes for 128-byte line
+            case 0x4: blkLength = 8*72+16+4;     break;
             //updateLength(8*(8 + _MAX_QWORDS_PER_LINE*4)+_MAX_QWORDS_PER_LINE+4, minLength, 0x4, minPattern);
+            // default (no compression)
+            // : original data + 4-bit prefix
+            default:  blkLength = _MAX_BYTES_PER_LINE*8 + 4;
         }
-        // default (no compression)
-        // : original data + 4-bit prefix
-        else {
-            countPattern(0xf);
-            blkLength = _MAX_BYTES_PER_LINE*8 + 4;
-        }
-
+        countPattern(encoding);
         countLineResult(blkLength);
 
         return blkLength;
     }
 
+    // encoding (= pattern ID) picked in the same order as the original cascade
+    // : the vector kernel checks every encoding over the whole line at once
+    int getEncoding(CACHELINE_DATA *line) {
+        if (incompressiblePrefix(line)) {
+            return 0xf;
+        }
+        if (bdi_classify!=NULL) {
+            return bdi_classify(line);
+        }
+        return getEncodingCascade(line);
+    }
+    int getEncodingCascade(CACHELINE_DATA *line) {
+        if (zero(line))                 return 0x0;
+        else if (rep_qword(line))       return 0x1;
+        else if (BDI_qword(line, 1))    return 0x2;
+        else if (BDI_dword(line, 1))    return 0x5;
+        else if (BDI_qword(line, 2))    return 0x3;
+        else if (BDI_dword(line, 2))    return 0x6;
+        else if (BDI_word(line, 1))     return 0x7;
+        else if (BDI_qword(line, 4))    return 0x4;
+        else                            return 0xf;
+    }
+
+    // Packed layout (byte aligned)
+    //   [encoding:1B][base][immediate mask: 1 bit per element][deltas]
+    //   zeros      : encoding only
+    //   rep. qword : encoding + qword
+    //   base+delta : mask bit set -> element = base + delta, clear -> immediate
+    //   raw        : encoding + line
+    // buf needs _MAX_BYTES_PER_LINE+1 bytes; returns the length in bits
+    LENGTH encodeLine(CACHELINE_DATA *line, UINT8 *buf) {
+        int encoding = getEncoding(line);
+        UINT8 *end;
+
+        buf[0] = encoding;
+        switch (encoding) {
+            case 0x0: end = buf+1;                                          break;
+            case 0x1: memcpy(buf+1, &line->qword[0], 8); end = buf+1+8;     break;
+            case 0x2: end = packBDI<UINT64>(line->qword, 1, buf+1);          break;
+            case 0x3: end = packBDI<UINT64>(line->qword, 2, buf+1);          break;
+            case 0x4: end = packBDI<UINT64>(line->qword, 4, buf+1);          break;
+            case 0x5: end = packBDI<UINT32>(line->dword, 1, buf+1);          break;
+            case 0x6: end = packBDI<UINT32>(line->dword, 2, buf+1);          break;
+            case 0x7: end = packBDI<UINT16>(line->word, 1, buf+1);           break;
+            default:  memcpy(buf+1, line, _MAX_BYTES_PER_LINE); end = buf+1+_MAX_BYTES_PER_LINE;
+        }
+        return (end-buf)*8;
+    }
+
+    void decodeLine(const UINT8 *buf, CACHELINE_DATA *line) {
+        switch (buf[0]) {
+            case 0x0: memset(line, 0, _MAX_BYTES_PER_LINE);                 break;
+            case 0x1:
+                for (int i=0; i<_MAX_QWORDS_PER_LINE; i++) {
+                    memcpy(&line->qword[i], buf+1, 8);
+                }
+                break;
+            case 0x2: unpackBDI<UINT64, INT8>(buf+1, line->qword);           break;
+            case 0x3: unpackBDI<UINT64, INT16>(buf+1, line->qword);          break;
+            case 0x4: unpackBDI<UINT64, INT32>(buf+1, line->qword);          break;
+            case 0x5: unpackBDI<UINT32, INT8>(buf+1, line->dword);           break;
+            case 0x6: unpackBDI<UINT32, INT16>(buf+1, line->dword);          break;
+            case 0x7: unpackBDI<UINT16, INT8>(buf+1, line->word);            break;
+            default:  memcpy(line, buf+1, _MAX_BYTES_PER_LINE);
+        }
+    }
+
+protected:
+    // The first two elements already rule out every encoding (most incompressible
+    // lines): both are bases/deltas at the widest delta of their size and too far
+    // apart, and the line is neither zeros nor repeated.
+    bool incompressiblePrefix(CACHELINE_DATA *line) {
+        INT64 dq = line->qword[1] - line->qword[0];
+        INT64 dd = (INT64) line->dword[1] - (INT64) line->dword[0];
+        INT64 dw = (INT64) line->word[1] - (INT64) line->word[0];
+        return !sign_extended(line->qword[0], 32) && !sign_extended(line->qword[1], 32) && !sign_extended(dq, 32)
+            && !sign_extended(line->dword[0], 16) && !sign_extended(line->dword[1], 16) && !sign_extended(dd, 16)
+            && !sign_extended(line->word[0], 8) && !sign_extended(line->word[1], 8) && !sign_extended(dw, 8);
+    }
+    // base = first element that is not an immediate (as in BDI_qword/dword/word)
+    template <typename T>
+    UINT8 *packBDI(const T *elem, UINT32 delta_byte_size, UINT8 *p) {
+        const unsigned n = _MAX_BYTES_PER_LINE/sizeof(T);
+        T base = 0;
+        for (unsigned i=0; i<n; i++) {
+            if (!sign_extended(elem[i], delta_byte_size*8)) {
+                base = elem[i];
+                break;
+            }
+        }
+        memcpy(p, &base, sizeof(T));
+        p += sizeof(T);
+
+        UINT8 *mask = p;
+        memset(mask, 0, (n+7)/8);
+        p += (n+7)/8;
+        for (unsigned i=0; i<n; i++) {
+            T delta = elem[i];
+            if (!sign_extended(elem[i], delta_byte_size*8)) {
+                delta -= base;
+                mask[i/8] |= (1<<(i%8));
+            }
+            memcpy(p, &delta, delta_byte_size);    // low bytes (little endian)
+            p += delta_byte_size;
+        }
+        return p;
+    }
+    // branch-free: fixed-width deltas, base selected by a lane mask
+    template <typename T, typename D>
+    void unpackBDI(const UINT8 *p, T *elem) {
+        const unsigned n = _MAX_BYTES_PER_LINE/sizeof(T);
+        T base;
+        UINT64 mask = 0;
+        D delta[n];
+        memcpy(&base, p, sizeof(T));
+        memcpy(&mask, p + sizeof(T), (n+7)/8);
+        memcpy(delta, p + sizeof(T) + (n+7)/8, sizeof(delta));
+        for (unsigned i=0; i<n; i++) {
+            T useBase = -((T) ((mask>>i)&1));
+            elem[i] = ((T) delta[i]) + (base & useBase);
+        }
+    }
+
 protected:
     bool BDI_qword(CACHELINE_DATA *line, UINT32 delta_byte_size) {
         UINT64 base;
@@ -0,0 +1,143 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __BPC_CLASSIFY_HH__
+#define __BPC_CLASSIFY_HH__
+
+#include "common.hh"
+#include "BPCCodeTable.hh"
+
+// define BPC_NO_SIMD to always use the scalar classifier
+#if (defined(__x86_64__) || defined(__i386__)) && ((LSIZE%256)==0) && !defined(BPC_NO_SIMD)
+#define BPC_SIMD
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------------------
+// Plane symbols of a line, for the BPC plane coders (encode_paper /
+// encode_table): one bit per plane in each mask, then a label per plane.
+// The coders walk the non-zero planes with the labels; the zero planes
+// between two of them are the run.
+typedef struct {
+    UINT32 zero;            // DBX == 0
+    UINT32 one;             // DBX == 1
+    UINT32 dbp_zero;        // DBP == 0
+    UINT32 all_ones;        // DBX == 0xffffffff
+    UINT32 all_but_lsb;     // DBX == 0xfffffffe
+    UINT32 single;          // at most one 1
+    UINT32 two_lsb;         // bit 0 and one more 1
+    UINT32 consecutive;     // 3 << pos
+} BPC_PLANE_MASKS;
+
+typedef void (*BPC_MASK_FUNC)(const UINT32 *dbx, const UINT32 *dbp, BPC_PLANE_MASKS *m);
+
+static void bpc_plane_masks_scalar(const UINT32 *dbx, const UINT32 *dbp, BPC_PLANE_MASKS *m) {
+    memset(m, 0, sizeof(*m));
+    for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+        UINT32 x = dbx[i];
+        UINT32 bit = 1u<<i;
+        m->zero        |= (x==0) ? bit : 0;
+        m->one         |= (x==1) ? bit : 0;
+        m->dbp_zero    |= (dbp[i]==0) ? bit : 0;
+        m->all_ones    |= (x==0xffffffff) ? bit : 0;
+        m->all_but_lsb |= (x==0xfffffffe) ? bit : 0;
+        m->single      |= ((x&(x-1))==0) ? bit : 0;
+        m->two_lsb     |= ((x&1) && (((x-1)&(x-2))==0)) ? bit : 0;
+        m->consecutive |= (x==(x&-x)*3) ? bit : 0;
+    }
+}
+
+#ifdef BPC_SIMD
+__attribute__((target("avx2")))
+static void bpc_plane_masks_avx2(const UINT32 *dbx, const UINT32 *dbp, BPC_PLANE_MASKS *m) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i all_ones = _mm256_set1_epi32(-1);
+    const __m256i all_but_lsb = _mm256_set1_epi32(-2);
+    memset(m, 0, sizeof(*m));
+    for (int k=0; k<_MAX_DWORDS_PER_LINE/8; k++) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) &dbx[k*8]);
+        __m256i p = _mm256_loadu_si256((const __m256i *) &dbp[k*8]);
+        __m256i x1 = _mm256_sub_epi32(x, one);
+        __m256i x2 = _mm256_sub_epi32(x, two);
+        __m256i low = _mm256_and_si256(x, _mm256_sub_epi32(zero, x));
+#define BPC_MASK(field, v) m->field |= ((UINT32) _mm256_movemask_ps(_mm256_castsi256_ps(v))) << (k*8)
+        BPC_MASK(zero,        _mm256_cmpeq_epi32(x, zero));
+        BPC_MASK(one,         _mm256_cmpeq_epi32(x, one));
+        BPC_MASK(dbp_zero,    _mm256_cmpeq_epi32(p, zero));
+        BPC_MASK(all_ones,    _mm256_cmpeq_epi32(x, all_ones));
+        BPC_MASK(all_but_lsb, _mm256_cmpeq_epi32(x, all_but_lsb));
+        BPC_MASK(single,      _mm256_cmpeq_epi32(_mm256_and_si256(x, x1), zero));
+        BPC_MASK(two_lsb,     _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(x, one), one),
+                                               _mm256_cmpeq_epi32(_mm256_and_si256(x1, x2), zero)));
+        BPC_MASK(consecutive, _mm256_cmpeq_epi32(x, _mm256_add_epi32(low, _mm256_slli_epi32(low, 1))));
+#undef BPC_MASK
+    }
+}
+#endif
+
+static BPC_MASK_FUNC bpc_select_plane_masks() {
+#ifdef BPC_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return bpc_plane_masks_avx2;
+    }
+#endif
+    return bpc_plane_masks_scalar;
+}
+
+static BPC_MASK_FUNC bpc_plane_masks = bpc_select_plane_masks();
+
+// labels (BPC_SYM_*) of the non-zero DBX planes, in the order the coders
+// test them; returns the non-zero planes
+static UINT32 bpc_classify_planes(const UINT32 *dbx, const UINT32 *dbp, UINT8 *label) {
+    BPC_PLANE_MASKS m;
+    bpc_plane_masks(dbx, dbp, &m);
+    const UINT32 classes[BPC_SYMS-1] = {
+        m.one, m.dbp_zero, m.all_ones, m.all_but_lsb, m.single, m.two_lsb, m.consecutive
+    };
+    static const UINT8 order[BPC_SYMS-1] = {
+        BPC_SYM_DBX_ONE, BPC_SYM_DBP_ZERO, BPC_SYM_ALL_ONES, BPC_SYM_ALL_ONES_BUT_LSB,
+        BPC_SYM_SINGLE, BPC_SYM_TWO_LSB, BPC_SYM_CONSECUTIVE
+    };
+    UINT32 nonzero = ~m.zero & (~0u >> (32-_MAX_DWORDS_PER_LINE));
+    UINT32 rest = nonzero;
+    for (int s=0; s<BPC_SYMS-1; s++) {
+        for (UINT32 planes = rest & classes[s]; planes!=0; planes &= planes-1) {
+            label[__builtin_ctz(planes)] = order[s];
+        }
+        rest &= ~classes[s];
+    }
+    for (; rest!=0; rest &= rest-1) {
+        label[__builtin_ctz(rest)] = BPC_SYM_RAW;
+    }
+    return nonzero;
+}
+
+//--------------------------------------------------------------------
+#endif /* __BPC_CLASSIFY_HH__ */
@@ -0,0 +1,280 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __BPC_CODE_TABLE_HH__
+#define __BPC_CODE_TABLE_HH__
+
+#include "common.hh"
+
+//--------------------------------------------------------------------
+// Trained code lengths for the BPC plane coders (encode_paper, code_mode 10)
+// With a table the runs of zero planes and the plane symbols share one
+// prefix code; symbols with a position or raw plane add their payload bits.
+// Tables are trained from the pattern counts the coders already keep:
+//   0..31      : run of 1..32 zero DBX planes
+//   32         : DBX == 1
+//   33         : zero DBP
+//   34         : all-one DBX
+//   35         : DBX == 0xfffffffe
+//   36         : uncompressed plane
+//   64+pos     : single 1
+//   96+pos     : two 1's, one of them at bit 0
+//   128+pos    : two consecutive 1's
+#define BPC_MAX_RUN         32
+#define BPC_MAX_CODE_LENGTH 16
+#define BPC_POS_BITS        5
+
+enum {
+    BPC_SYM_DBX_ONE,
+    BPC_SYM_DBP_ZERO,
+    BPC_SYM_ALL_ONES,
+    BPC_SYM_ALL_ONES_BUT_LSB,
+    BPC_SYM_RAW,
+    BPC_SYM_SINGLE,
+    BPC_SYM_TWO_LSB,
+    BPC_SYM_CONSECUTIVE,
+    BPC_SYMS
+};
+
+typedef struct {
+    UINT8 run[BPC_MAX_RUN+1];   // run of k zero planes (run[0] unused)
+    UINT8 sym[BPC_SYMS];        // plane symbols, payload excluded
+} BPC_CODE_TABLE;
+
+typedef struct {
+    const char *name;           // bpcTableName() of the compressor it was trained for
+    const BPC_CODE_TABLE *table;
+} BPC_NAMED_TABLE;
+
+// tables baked in at build time: -DBPC_CODE_TABLES='"file.hh"' with a file
+// written by vsc -g (defines BPC_TRAINED_TABLES[])
+#ifdef BPC_CODE_TABLES
+#include BPC_CODE_TABLES
+#endif
+
+// name of a compressor's table: its runs and raw planes depend on the line
+// size, so a table is trained for and applied at one LSIZE
+static string bpcTableName(const string &name) {
+    return name + "_" + to_string(LSIZE/8) + "B";
+}
+
+// false if a table has no code for a run of up to a line's planes (a table
+// trained at a shorter line size)
+static bool bpcTableCovers(const BPC_CODE_TABLE &table) {
+    for (int k=1; k<=_MAX_DWORDS_PER_LINE; k++) {
+        if (table.run[k]==0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// plane symbol of a pattern id, -1 for runs and other patterns
+static int bpcSymbolOf(INT64 pattern) {
+    switch (pattern) {
+        case 32: return BPC_SYM_DBX_ONE;
+        case 33: return BPC_SYM_DBP_ZERO;
+        case 34: return BPC_SYM_ALL_ONES;
+        case 35: return BPC_SYM_ALL_ONES_BUT_LSB;
+        case 36: return BPC_SYM_RAW;
+    }
+    if ((pattern>=64) && (pattern<96)) {
+        return BPC_SYM_SINGLE;
+    } else if ((pattern>=96) && (pattern<128)) {
+        return BPC_SYM_TWO_LSB;
+    } else if ((pattern>=128) && (pattern<160)) {
+        return BPC_SYM_CONSECUTIVE;
+    }
+    return -1;
+}
+
+// pattern id of a plane symbol (bpcSymbolOf() backwards)
+static INT64 bpcPatternOf(int sym, UINT32 plane) {
+    static const INT64 PATTERN[BPC_SYMS] = {32, 33, 34, 35, 36, 64, 96, 128};
+    return (sym>=BPC_SYM_SINGLE) ? PATTERN[sym]+__builtin_ctz(plane) : PATTERN[sym];
+}
+
+// length-limited Huffman code lengths (package-merge)
+// : every freq must be non-zero; len gets one length per symbol
+static void bpcCodeLengths(const vector<CNT> &freq, unsigned limit, vector<unsigned> &len) {
+    unsigned n = freq.size();
+    len.assign(n, 0);
+    if (n<2) {
+        len.assign(n, 1);
+        return;
+    }
+    assert((1ull<<limit) >= n);
+    // item: weight and how many times it holds each leaf
+    typedef pair<CNT, vector<unsigned> > ITEM;
+    vector<ITEM> leaves;
+    for (unsigned i=0; i<n; i++) {
+        leaves.push_back(ITEM(freq[i], vector<unsigned>(n, 0)));
+        leaves.back().second[i] = 1;
+    }
+    sort(leaves.begin(), leaves.end());
+    vector<ITEM> items = leaves;
+    for (unsigned level=1; level<limit; level++) {
+        vector<ITEM> packages;
+        for (unsigned i=0; i+1<items.size(); i+=2) {
+            ITEM p(items[i].first+items[i+1].first, items[i].second);
+            for (unsigned l=0; l<n; l++) {
+                p.second[l] += items[i+1].second[l];
+            }
+            packages.push_back(p);
+        }
+        items.resize(leaves.size()+packages.size());
+        merge(leaves.begin(), leaves.end(), packages.begin(), packages.end(), items.begin(),
+              [](const ITEM &a, const ITEM &b) { return a.first < b.first; });
+    }
+    for (unsigned i=0; i<2*n-2; i++) {
+        for (unsigned l=0; l<n; l++) {
+            len[l] += items[i].second[l];
+        }
+    }
+}
+
+// code table for a coder that emits runs of 1..max_run planes and the
+// plane symbols in sym_mask (bit s: symbol s), from its pattern counts
+// : every symbol the coder can emit gets a code, seen or not
+static BPC_CODE_TABLE bpcTrainTable(const map<INT64, CNT> &counts, unsigned max_run, UINT32 sym_mask) {
+    vector<CNT> freq(BPC_MAX_RUN+1+BPC_SYMS, 1ull);     // add-one for unseen symbols
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        if ((it->first>=0) && (it->first<(INT64) max_run)) {
+            freq[it->first+1] += it->second;
+        } else if (bpcSymbolOf(it->first)>=0) {
+            freq[BPC_MAX_RUN+1+bpcSymbolOf(it->first)] += it->second;
+        }
+    }
+    vector<CNT> used;
+    for (unsigned k=1; k<=max_run; k++) {
+        used.push_back(freq[k]);
+    }
+    for (unsigned s=0; s<BPC_SYMS; s++) {
+        if ((sym_mask>>s)&1) {
+            used.push_back(freq[BPC_MAX_RUN+1+s]);
+        }
+    }
+    vector<unsigned> len;
+    bpcCodeLengths(used, BPC_MAX_CODE_LENGTH, len);
+
+    BPC_CODE_TABLE table = {};
+    unsigned i = 0;
+    for (unsigned k=1; k<=max_run; k++) {
+        table.run[k] = len[i++];
+    }
+    for (unsigned s=0; s<BPC_SYMS; s++) {
+        if ((sym_mask>>s)&1) {
+            table.sym[s] = len[i++];
+        }
+    }
+    return table;
+}
+
+//--------------------------------------------------------------------
+// generated table header (vsc -g) and its start-up loader (vsc -T)
+static void bpcWriteTables(FILE *fd, const vector<pair<string, BPC_CODE_TABLE> > &tables) {
+    fprintf(fd, "// BPC code tables generated by vsc -g: do not edit\n");
+    fprintf(fd, "// build with -DBPC_CODE_TABLES='\"<this file>\"' or load at start-up with vsc -T <this file>\n");
+    fprintf(fd, "#ifndef __BPC_TRAINED_TABLES_HH__\n#define __BPC_TRAINED_TABLES_HH__\n\n");
+    for (unsigned t=0; t<tables.size(); t++) {
+        const BPC_CODE_TABLE &table = tables[t].second;
+        fprintf(fd, "// %s\nconstexpr BPC_CODE_TABLE BPC_TRAINED_TABLE_%u = {\n    {", tables[t].first.c_str(), t);
+        for (int k=0; k<=BPC_MAX_RUN; k++) {
+            fprintf(fd, "%s%u", (k==0) ? "" : ", ", table.run[k]);
+        }
+        fprintf(fd, "},\n    {");
+        for (int s=0; s<BPC_SYMS; s++) {
+            fprintf(fd, "%s%u", (s==0) ? "" : ", ", table.sym[s]);
+        }
+        fprintf(fd, "} };\n\n");
+    }
+    fprintf(fd, "static const BPC_NAMED_TABLE BPC_TRAINED_TABLES[] = {\n");
+    for (unsigned t=0; t<tables.size(); t++) {
+        fprintf(fd, "    { \"%s\", &BPC_TRAINED_TABLE_%u },\n", tables[t].first.c_str(), t);
+    }
+    fprintf(fd, "};\n\n#endif /* __BPC_TRAINED_TABLES_HH__ */\n");
+}
+
+// reads the tables of a file written by bpcWriteTables()
+// : false if the file cannot be read or is not such a file
+static bool bpcLoadTables(const char *file, vector<pair<string, BPC_CODE_TABLE> > &tables) {
+    FILE *fd = fopen(file, "r");
+    if (fd==NULL) {
+        return false;
+    }
+    string text;
+    char buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), fd))>0) {
+        text.append(buf, got);
+    }
+    fclose(fd);
+
+    // table bodies: BPC_MAX_RUN+1+BPC_SYMS numbers after each '='
+    vector<BPC_CODE_TABLE> bodies;
+    for (size_t pos = text.find("constexpr BPC_CODE_TABLE"); pos != string::npos; pos = text.find("constexpr BPC_CODE_TABLE", pos+1)) {
+        const char *p = text.c_str() + text.find('=', pos);
+        BPC_CODE_TABLE table;
+        for (int i=0; i<BPC_MAX_RUN+1+BPC_SYMS; i++) {
+            while ((*p!=0) && ((*p<'0') || (*p>'9'))) {
+                p++;
+            }
+            if (*p==0) {
+                return false;
+            }
+            unsigned value = (unsigned) strtoul(p, (char **) &p, 10);
+            if (i<=BPC_MAX_RUN) {
+                table.run[i] = value;
+            } else {
+                table.sym[i-BPC_MAX_RUN-1] = value;
+            }
+        }
+        bodies.push_back(table);
+    }
+    // names, in table order: { "name", &BPC_TRAINED_TABLE_<t> }
+    size_t list = text.find("BPC_TRAINED_TABLES[]");
+    if (list==string::npos) {
+        return false;
+    }
+    for (size_t pos = text.find('"', list); pos != string::npos; pos = text.find('"', pos+1)) {
+        size_t end = text.find('"', pos+1);
+        size_t ref = text.find("&BPC_TRAINED_TABLE_", end);
+        if ((end==string::npos) || (ref==string::npos)) {
+            return false;
+        }
+        unsigned t = (unsigned) strtoul(text.c_str()+ref+strlen("&BPC_TRAINED_TABLE_"), NULL, 10);
+        if (t>=bodies.size()) {
+            return false;
+        }
+        tables.push_back(pair<string, BPC_CODE_TABLE>(text.substr(pos+1, end-pos-1), bodies[t]));
+        pos = end;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------
+#endif /* __BPC_CODE_TABLE_HH__ */
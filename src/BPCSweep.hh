@@ -0,0 +1,257 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __BPC_SWEEP_HH__
+#define __BPC_SWEEP_HH__
+
+#include <chrono>
+#include "common.hh"
+#include "BPCompressor.hh"
+#include "PagePacker.hh"
+
+//--------------------------------------------------------------------
+// One-pass sweep over BPSCompressorDW configurations (vsc -c bpsweep:...)
+// : each line is transformed once per diff mode and turned into bit-planes
+//   once per (diff mode, plane set); every configuration then runs only its
+//   own coder and fragmentation on the shared planes
+// : the coders read the DBP / DBX planes only, which bp modes 1-3 build
+//   alike; bp mode 0 leaves them empty and bp mode 4 drops the first dword
+// : per configuration it packs pages as vsc does for a compressor, and
+//   estimates its stand-alone time per line as the time of the transform
+//   and planes it uses plus the time of its own coder
+// : compressLine() reports the best configuration of each line (selector
+//   bits not counted), like Oracle-Line
+
+// lines taken through each step at a time; small enough to stay in L1
+#define SWEEP_BATCH 8
+
+static const int SWEEP_PLANE_SETS = 3;  // bp mode 0, 1-3, 4
+static int sweepPlaneSet(int bp_mode) { return (bp_mode==0) ? 0 : (bp_mode==4) ? 2 : 1; }
+
+class BPSSweepDW : public Compressor {
+public:
+    BPSSweepDW(const string name) : Compressor(name), block_frag(1), page_frag(0), lines(0ull) {}
+    ~BPSSweepDW() {}
+    Compressor *clone() const { return new BPSSweepDW(*this); }
+
+    // configurations sharing a diff mode and plane set share that work
+    void add(const BPSCompressorDW &config) {
+        int d;
+        for (d=0; d<(int) diff_modes.size(); d++) {
+            if (diff_modes[d]==config.getDiffMode()) {
+                break;
+            }
+        }
+        if (d==(int) diff_modes.size()) {
+            diff_modes.push_back(config.getDiffMode());
+            diff_ns.push_back(0.0);
+        }
+        int p;
+        for (p=0; p<(int) plane_diff.size(); p++) {
+            if ((plane_diff[p]==d) && (sweepPlaneSet(configs[plane_owner[p]].getBPMode())==sweepPlaneSet(config.getBPMode()))) {
+                break;
+            }
+        }
+        if (p==(int) plane_diff.size()) {
+            plane_diff.push_back(d);
+            plane_owner.push_back(configs.size());
+            plane_ns.push_back(0.0);
+        }
+        configs.push_back(config);
+        config_diff.push_back(d);
+        config_plane.push_back(p);
+        code_ns.push_back(0.0);
+        bits.push_back(0ull);
+        sizes.resize(configs.size()*LINE_PER_PAGE);
+        diff_buffer.resize(diff_modes.size()*SWEEP_BATCH);
+        diff_result.resize(diff_modes.size()*SWEEP_BATCH);
+        dbp_buffer.resize(plane_diff.size()*SWEEP_BATCH);
+        dbx_buffer.resize(plane_diff.size()*SWEEP_BATCH);
+    }
+    unsigned getConfigCount() const { return configs.size(); }
+    // page packing of the configurations (packPage())
+    void setPacking(int _block_frag, int _page_frag) {
+        block_frag = _block_frag;
+        page_frag = _page_frag;
+    }
+
+    void reset() {
+        Compressor::reset();
+        for (unsigned c=0; c<configs.size(); c++) {
+            configs[c].reset();
+            code_ns[c] = 0.0;
+            bits[c] = 0ull;
+        }
+        fill(diff_ns.begin(), diff_ns.end(), 0.0);
+        fill(plane_ns.begin(), plane_ns.end(), 0.0);
+        lines = 0ull;
+    }
+    void seed(CACHELINE_DATA* line) {
+        for (unsigned c=0; c<configs.size(); c++) {
+            configs[c].seed(line);
+        }
+    }
+    void mergeStatistics(const Compressor &other) {
+        Compressor::mergeStatistics(other);
+        const BPSSweepDW &sweep = dynamic_cast<const BPSSweepDW &>(other);
+        for (unsigned c=0; c<configs.size(); c++) {
+            configs[c].mergeStatistics(sweep.configs[c]);
+            code_ns[c] += sweep.code_ns[c];
+            bits[c] += sweep.bits[c];
+        }
+        for (unsigned d=0; d<diff_ns.size(); d++) {
+            diff_ns[d] += sweep.diff_ns[d];
+        }
+        for (unsigned p=0; p<plane_ns.size(); p++) {
+            plane_ns[p] += sweep.plane_ns[p];
+        }
+        lines += sweep.lines;
+    }
+
+    unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
+        LENGTH length;
+        compressLines(line, 1, line_addr, &length);
+        return length;
+    }
+    // the lines of one page at most (vsc hands over a page at a time)
+    void compressLines(CACHELINE_DATA* line, size_t n, UINT64 line_addr, LENGTH* out) {
+        unsigned first = (line_addr/_MAX_BYTES_PER_LINE) % LINE_PER_PAGE;
+        assert(first+n <= LINE_PER_PAGE);
+        for (size_t i=0; i<n; i+=SWEEP_BATCH) {
+            compressBatch(&line[i], min(n-i, (size_t) SWEEP_BATCH), first+i, &out[i]);
+        }
+        lines += n;
+        if ((first+n)%LINE_PER_PAGE==0) {
+            for (unsigned c=0; c<configs.size(); c++) {
+                bits[c] += packPage(&sizes[c*LINE_PER_PAGE], block_frag, page_frag);
+            }
+        }
+    }
+
+    // ratio (over uncompressed_bits) and estimated stand-alone ns/line of
+    // every configuration, fastest first; * marks the Pareto front
+    void printSweep(FILE *fd, CNT uncompressed_bits) const {
+        unsigned n = configs.size();
+        vector<double> ratio(n), ns(n);
+        vector<unsigned> order(n);
+        double shared_ns = 0.0, alone_ns = 0.0;
+        for (unsigned d=0; d<diff_ns.size(); d++) {
+            shared_ns += diff_ns[d];
+        }
+        for (unsigned p=0; p<plane_ns.size(); p++) {
+            shared_ns += plane_ns[p];
+        }
+        for (unsigned c=0; c<n; c++) {
+            ratio[c] = (bits[c]==0) ? 0.0 : uncompressed_bits/(double) bits[c];
+            ns[c] = (diff_ns[config_diff[c]] + plane_ns[config_plane[c]] + code_ns[c]) / max(lines, 1ull);
+            shared_ns += code_ns[c];
+            alone_ns += ns[c];
+            order[c] = c;
+        }
+        sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+            return (ns[a]<ns[b]) || ((ns[a]==ns[b]) && (ratio[a]>ratio[b]));
+        });
+        fprintf(fd, "Sweep %s: %u configurations, %lld lines, %.1f ns/line in one pass (%.1f ns/line run one by one)\n",
+                name.c_str(), n, lines, shared_ns/max(lines, 1ull), alone_ns);
+        fprintf(fd, "  %-24s %10s %10s\n", "configuration", "Comp_Ratio", "ns/line");
+        double best_ratio = 0.0;
+        for (unsigned k=0; k<n; k++) {
+            unsigned c = order[k];
+            // sorted by time: on the front if no faster one compresses as well
+            bool front = (ratio[c] > best_ratio);
+            best_ratio = max(best_ratio, ratio[c]);
+            fprintf(fd, "  %-24s %10.2f %10.1f %s\n", configs[c].getName().c_str(), ratio[c], ns[c], front ? "*" : "");
+        }
+    }
+
+protected:
+    void compressBatch(CACHELINE_DATA *line, size_t n, unsigned lineno, LENGTH *out) {
+        typedef chrono::steady_clock CLOCK;
+        CLOCK::time_point t0 = CLOCK::now(), t1;
+
+        // transforms: the first configuration of a diff mode keeps its state
+        for (unsigned d=0; d<diff_modes.size(); d++) {
+            BPSCompressorDW &owner = configs[plane_owner[firstPlane(d)]];
+            for (size_t i=0; i<n; i++) {
+                diff_result[d*SWEEP_BATCH+i] = owner.transform(&line[i], diff_buffer[d*SWEEP_BATCH+i]);
+            }
+            t1 = CLOCK::now();
+            diff_ns[d] += chrono::duration<double, nano>(t1-t0).count();
+            t0 = t1;
+        }
+        for (unsigned p=0; p<plane_diff.size(); p++) {
+            BPSCompressorDW &owner = configs[plane_owner[p]];
+            for (size_t i=0; i<n; i++) {
+                BITPLANE_DATA bp_buffer, dbx2_buffer;
+                owner.bitplanes(&line[i], diff_result[plane_diff[p]*SWEEP_BATCH+i], bp_buffer, dbp_buffer[p*SWEEP_BATCH+i], dbx_buffer[p*SWEEP_BATCH+i], dbx2_buffer);
+            }
+            t1 = CLOCK::now();
+            plane_ns[p] += chrono::duration<double, nano>(t1-t0).count();
+            t0 = t1;
+        }
+        for (unsigned c=0; c<configs.size(); c++) {
+            unsigned d = config_diff[c], p = config_plane[c];
+            for (size_t i=0; i<n; i++) {
+                LENGTH length = configs[c].compressPlanes(&line[i], diff_result[d*SWEEP_BATCH+i], &dbx_buffer[p*SWEEP_BATCH+i], &dbp_buffer[p*SWEEP_BATCH+i]);
+                sizes[c*LINE_PER_PAGE+lineno+i] = length;
+                out[i] = (c==0) ? length : min(out[i], length);
+            }
+            t1 = CLOCK::now();
+            code_ns[c] += chrono::duration<double, nano>(t1-t0).count();
+            t0 = t1;
+        }
+        for (size_t i=0; i<n; i++) {
+            countLineResult(out[i]);
+        }
+    }
+    unsigned firstPlane(unsigned d) const {
+        unsigned p = 0;
+        while (plane_diff[p]!=(int) d) {
+            p++;
+        }
+        return p;
+    }
+
+    int block_frag, page_frag;
+    vector<BPSCompressorDW> configs;
+    vector<int> diff_modes;             // distinct diff modes
+    vector<int> plane_diff;             // plane sets: diff mode (index) ...
+    vector<unsigned> plane_owner;       // ... and the configuration building them
+    vector<int> config_diff, config_plane;
+    // time spent per diff mode / plane set / configuration and packed bits
+    vector<double> diff_ns, plane_ns, code_ns;
+    vector<CNT> bits;
+    CNT lines;
+    // per-batch scratch: transformed lines and planes, page of line sizes
+    vector<CACHELINE_DATA> diff_buffer;
+    vector<CACHELINE_DATA *> diff_result;
+    vector<BITPLANE_DATA> dbp_buffer, dbx_buffer;
+    vector<unsigned> sizes;
+};
+
+//--------------------------------------------------------------------
+#endif /* __BPC_SWEEP_HH__ */
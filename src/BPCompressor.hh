@@ -29,20 +29,16 @@
 #define __BP_COMPRESSOR_HH__
 
 #include "common.hh"
+#include "bitplane.hh"
+#include "BitStream.hh"
+#include "BPCCodeTable.hh"
+#include "BPCClassify.hh"
 //------------------------------------------------------------------------------
-bool sign_extended(UINT64 value, UINT8 bit_size) {
-    UINT64 max = (1ULL << (bit_size-1)) - 1;    // bit_size: 4 -> ...00000111
-    UINT64 min = ~max;                          // bit_size: 4 -> ...11111000
-    return (value <= max) | (value >= min);
-}
-
-bool zero_extended(UINT64 value, UINT8 bit_size) {
-    UINT64 max = (1ULL << (bit_size)) - 1;      // bit_size: 4 -> ...00001111
-    return (value <= max);
-}
-class BPCompressor64 : public ECompressor {
+class BPCompressor64 : public Compressor {
 public:
-    BPCompressor64(const string name) : ECompressor(name) {}
+    BPCompressor64(const string name) : Compressor(name) {}
+    Compressor *clone() const { return new BPCompressor64(*this); }
+    COMPRESS_LINES(BPCompressor64)
     unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
         INT64 deltas[15];
         bool delta_signs[15];
@@ -201,14 +197,16 @@ public:
         return length;
     }
 };
-class BPSCompressorDW : public ECompressor {
+class BPSCompressorDW : public Compressor {
 public:
     BPSCompressorDW(const string name, int diff, int bp, int code, int fragblocks)
-    : ECompressor(name), diff_mode(diff), bp_mode(bp), code_mode(code), frag_mode(fragblocks){}
+    : Compressor(name), diff_mode(diff), bp_mode(bp), code_mode(code), frag_mode(fragblocks), codes(NULL) {}
     ~BPSCompressorDW() {}
+    Compressor *clone() const { return new BPSCompressorDW(*this); }
+    COMPRESS_LINES(BPSCompressorDW)
 public:
     void reset() {
-        ECompressor::reset();
+        Compressor::reset();
 
         prev_zero = true;
         prev_data = 0;
@@ -217,38 +215,58 @@ public:
 
         run_length = 0;
     }
+    void seed(CACHELINE_DATA* line) {
+        // same state transform() leaves behind after this line
+        prev_data = line->dword[_MAX_DWORDS_PER_LINE-1];
+        prev_delta = line->dword[_MAX_DWORDS_PER_LINE-1] - line->dword[_MAX_DWORDS_PER_LINE-2];
+        prev_line = *line;
+    }
 
     CACHELINE_DATA* transform(CACHELINE_DATA* line, CACHELINE_DATA &buffer) {
-        if (diff_mode==0) {              // raw
+        switch (diff_mode) {
+            case 0: return transformMode<0>(line, buffer);
+            case 1: return transformMode<1>(line, buffer);
+            case 2: return transformMode<2>(line, buffer);
+            case 3: return transformMode<3>(line, buffer);
+            case 4: return transformMode<4>(line, buffer);
+            case 5: return transformMode<5>(line, buffer);
+            case 6: return transformMode<6>(line, buffer);
+        }
+        return &buffer;
+    }
+    // transform() of one diff mode (BPSCompressorDWT uses it directly)
+    template<int DIFF>
+    CACHELINE_DATA* transformMode(CACHELINE_DATA* line, CACHELINE_DATA &buffer) {
+        if (DIFF==0) {              // raw
             return line;
-        } else if (diff_mode==1) {       // delta
+        } else if (DIFF==1) {       // delta
             for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
                 buffer.dword[i] = (line->dword[i] - prev_data);
                 prev_data = line->dword[i];
             }
-        } else if (diff_mode==2) {       // XOR
+        } else if (DIFF==2) {       // XOR
             for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
                 buffer.dword[i] = (line->dword[i] ^ prev_data);
                 prev_data = line->dword[i];
             }
-        } else if (diff_mode==3) {      // block delta
+        } else if (DIFF==3) {      // block delta
             for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
                 buffer.dword[i] = (prev_line.dword[i] - line->dword[i]);
             }
             prev_line = *line;
-        } else if (diff_mode==4) {      // delta-delta
+        } else if (DIFF==4) {      // delta-delta
             for (unsigned i=0; i<_MAX_DWORDS_PER_LINE; i++) {
                 INT32 delta = line->dword[i] - prev_data;
                 buffer.dword[i] = (prev_delta - delta);
                 prev_data = line->dword[i];
                 prev_delta = delta;
             }
-        } else if (diff_mode==5) {
+        } else if (DIFF==5) {
             buffer.dword[0] = line->dword[0];
             for (int i=1; i<_MAX_DWORDS_PER_LINE; i++) {
                 buffer.dword[i] = (line->dword[i] - line->dword[i-1]);
             }
-        } else if (diff_mode==6) {
+        } else if (DIFF==6) {
             buffer.dword[0] = line->dword[0];
             buffer.dword[1] = line->dword[1] - line->dword[0];
             for (int i=2; i<_MAX_DWORDS_PER_LINE; i++) {
@@ -257,20 +275,35 @@ public:
         }
         return &buffer;
     }
-    unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
-        CACHELINE_DATA diff_buffer;
-        CACHELINE_DATA *diff_result = transform(line, diff_buffer);
-
-        // BP mode
-//TODO: These sizes need to be changed for a smaller cache line size
-        CACHELINE_DATA bp_buffer = {};
-        CACHELINE_DATA dbp_buffer = {};
-        CACHELINE_DATA dbx_buffer = {};
-        CACHELINE_DATA dbx2_buffer = {};
-        CACHELINE_DATA *bp_result = NULL;
+    // builds BP, DBP, DBX and DBX2 planes, returns the ones bp_mode selects
+    UINT32 *bitplanes(CACHELINE_DATA *line, CACHELINE_DATA *diff_result, BITPLANE_DATA &bp_buffer, BITPLANE_DATA &dbp_buffer, BITPLANE_DATA &dbx_buffer, BITPLANE_DATA &dbx2_buffer) {
+        UINT32 *bp_result = NULL;
 
         if (bp_mode==0) {           // no BP
-            bp_result = diff_result;
+            // the coders still read (empty) planes; every other mode writes all 32
+            memset(&dbp_buffer, 0, sizeof(dbp_buffer));
+            memset(&dbx_buffer, 0, sizeof(dbx_buffer));
+            bp_result = diff_result->dword;
+        } else if (bp_transpose!=NULL) {    // vectorized BP / BPX
+            bp_transpose(line->dword, bp_buffer.dword);
+            bp_build_planes(diff_result->dword, dbp_buffer.dword, dbx_buffer.dword, dbx2_buffer.dword);
+            if (bp_mode==4) {       // first dword excluded
+                for (int j=0; j<32; j++) {
+                    bp_buffer.dword[j]   >>= 1;
+                    dbp_buffer.dword[j]  >>= 1;
+                    dbx_buffer.dword[j]  >>= 1;
+                    dbx2_buffer.dword[j] >>= 1;
+                }
+            }
+            if (bp_mode==1) {
+                bp_result = bp_buffer.dword;
+            } else if ((bp_mode==2) || (bp_mode==4)) {
+                bp_result = dbx_buffer.dword;
+            } else if (bp_mode==3) {
+                bp_result = dbx2_buffer.dword;
+            } else {
+                assert(0);
+            }
         } else if (bp_mode==4) {
             for (int j=31; j>=0; j--) {
                 INT32 bufBP = 0;
@@ -297,7 +330,7 @@ public:
                 dbx_buffer.dword[j]  = bufDBX;
                 dbx2_buffer.dword[j] = bufDBX2;
             }
-            bp_result = &dbx_buffer;
+            bp_result = dbx_buffer.dword;
         } else {                    // BP / BPX
             for (int j=31; j>=0; j--) {
                 INT32 bufBP = 0;
@@ -325,125 +358,157 @@ public:
                 dbx2_buffer.dword[j] = bufDBX2;
             }
             if (bp_mode==1) {
-                bp_result = &bp_buffer;
+                bp_result = bp_buffer.dword;
             } else if (bp_mode==2) {
-                bp_result = &dbx_buffer;
+                bp_result = dbx_buffer.dword;
             } else if (bp_mode==3) {
-                bp_result = &dbx2_buffer;
+                bp_result = dbx2_buffer.dword;
             } else {
                 assert(0);
             }
         }
+        return bp_result;
+    }
+    // only the DBP and DBX planes the coders read, for one bp mode
+    // (the same planes bitplanes() builds)
+    template<int BP>
+    void planesMode(CACHELINE_DATA *diff_result, BITPLANE_DATA &dbp_buffer, BITPLANE_DATA &dbx_buffer) {
+        if (BP==0) {
+            memset(&dbp_buffer, 0, sizeof(dbp_buffer));
+            memset(&dbx_buffer, 0, sizeof(dbx_buffer));
+        } else if (bp_transpose!=NULL) {
+            bp_build_planes(diff_result->dword, dbp_buffer.dword, dbx_buffer.dword, NULL);
+            if (BP==4) {    // first dword excluded
+                for (int j=0; j<32; j++) {
+                    dbp_buffer.dword[j] >>= 1;
+                    dbx_buffer.dword[j] >>= 1;
+                }
+            }
+        } else {
+            const int first = (BP==4) ? 1 : 0;
+            for (int j=31; j>=0; j--) {
+                INT32 bufDBP = 0;
+                INT32 bufDBX = 0;
+                for (int i=_MAX_DWORDS_PER_LINE-1; i>=first; i--) {
+                    bufDBP  <<= 1;
+                    bufDBX  <<= 1;
+                    bufDBP  |= ((diff_result->dword[i]>>j)&1);
+                    if (j==31) {
+                        bufDBX  |= ((diff_result->dword[i]>>j)&1);
+                    } else {
+                        bufDBX  |= (((diff_result->dword[i]>>j)^(diff_result->dword[i]>>(j+1)))&1);
+                    }
+                }
+                dbp_buffer.dword[j]  = bufDBP;
+                dbx_buffer.dword[j]  = bufDBX;
+            }
+        }
+    }
+    unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
+        PHASE_BEGIN(t);
+        CACHELINE_DATA diff_buffer;
+        CACHELINE_DATA *diff_result = transform(line, diff_buffer);
+        PHASE_END(PHASE_TRANSFORM, t);
+
+        // BP mode
+        BITPLANE_DATA bp_buffer, dbp_buffer, dbx_buffer, dbx2_buffer;
+        bitplanes(line, diff_result, bp_buffer, dbp_buffer, dbx_buffer, dbx2_buffer);
+        PHASE_END(PHASE_BITPLANE, t);
+
+        unsigned blkLength = encode(line, diff_result, &dbx_buffer, &dbp_buffer);
+        PHASE_END(PHASE_ENCODE, t);
+
+        blkLength = fragment(blkLength);
+        countLineResult(blkLength);
+        PHASE_END(PHASE_FRAG, t);
+
+        return blkLength;
+    }
+    // compressLine() after transform() and bitplanes() (BPCSweep.hh shares those)
+    unsigned compressPlanes(CACHELINE_DATA *line, CACHELINE_DATA *diff_result, BITPLANE_DATA *dbx, BITPLANE_DATA *dbp) {
+        unsigned blkLength = fragment(encode(line, diff_result, dbx, dbp));
+        countLineResult(blkLength);
+        return blkLength;
+    }
+    unsigned encode(CACHELINE_DATA *line, CACHELINE_DATA *diff_result, BITPLANE_DATA *dbx, BITPLANE_DATA *dbp) {
+        switch (code_mode) {
+            case 10: return encodeMode<10>(line, diff_result, dbx, dbp);
+            case 11: return encodeMode<11>(line, diff_result, dbx, dbp);
+            case 12: return encodeMode<12>(line, diff_result, dbx, dbp);
+        }
+        return 0;
+    }
+    template<int CODE>
+    unsigned encodeMode(CACHELINE_DATA *line, CACHELINE_DATA *diff_result, BITPLANE_DATA *dbx, BITPLANE_DATA *dbp) {
         unsigned blkLength = 0;
-        if (code_mode==10) {
-            blkLength = encode_paper(&dbx_buffer, &dbp_buffer, line);
+        if (CODE==10) {
+            blkLength = (codes!=NULL) ? encode_table(dbx, dbp) : encode_paper(dbx, dbp, line);
         }
-        else if (code_mode==11) {
-            if (((diff_buffer.dword[0])&0xFFFFFF00)==0) {   // {2'b10,8bit}
+        else if (CODE==11) {
+            if (((diff_result->dword[0])&0xFFFFFF00)==0) {   // {2'b10,8bit}
                 blkLength += 10;
-            } else if (((diff_buffer.dword[0])&0xFFFF0000)==0) {    // {2'b11,16-bit}
+            } else if (((diff_result->dword[0])&0xFFFF0000)==0) {    // {2'b11,16-bit}
                 blkLength += 18;
             } else {    // {1'b0, 32-bit}
                 blkLength += 33;
             }
-            blkLength += encode_paper2(&dbx_buffer, &dbp_buffer);
+            blkLength += encode_paper2(dbx, dbp);
         }
-
+        else if (CODE==12) {
+            BitWriter counter(NULL, 0);
+            blkLength = encode_bitstream(diff_result->dword[0], dbx, dbp, counter, true);
+        }
+        return blkLength;
+    }
 //Fragmentation as per cache block size
-
-        if(frag_mode<4) {
-            for (int i=1; i<sizeof(block_sizes[frag_mode]); i++) {
-                if(blkLength > block_sizes[frag_mode][i]) {
-                    blkLength = block_sizes[frag_mode][i-1];
+    // frag_mode 0-2: rounds up to the smallest block of block_sizes[frag_mode]
+    // that holds the line, or to the whole line when none does
+    unsigned fragment(unsigned blkLength) {
+        if(frag_mode<3) {
+            unsigned block = LSIZE;
+            for (unsigned i=0; i<sizeof(block_sizes[frag_mode])/sizeof(block_sizes[frag_mode][0]); i++) {
+                if(blkLength <= block_sizes[frag_mode][i]) {
+                    block = block_sizes[frag_mode][i];
                     break;
                 }
-                if(i== sizeof(block_sizes[frag_mode])-1)
-                    blkLength = block_sizes[frag_mode][i];
             }
+            blkLength = block;
         }
 
         if (blkLength > LSIZE)
             blkLength = LSIZE;
-        countLineResult(blkLength);
-
         return blkLength;
     }
+    int getDiffMode() const { return diff_mode; }
+    int getBPMode() const { return bp_mode; }
 
-    unsigned encode_paper(CACHELINE_DATA *dbx, CACHELINE_DATA *dbp, CACHELINE_DATA *line) {
+    // the planes are labelled up front (BPCClassify.hh); the zero planes
+    // between two labelled ones are the runs
+    unsigned encode_paper(BITPLANE_DATA *dbx, BITPLANE_DATA *dbp, CACHELINE_DATA *line) {
         //static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 8, 6, 8, 11, 7, 7, 9, 10, 9, 8, 9, 9, 10, 10, 10, 11, 9, 9, 10, 5, 8, 9, 10, 11, 11, 6, 9, 7, 10, 8, 10};
 
         static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 6, 7, 8, 9, 6, 10, 12, 12, 8, 8, 9, 10, 9, 11, 11, 9, 9, 9, 10, 11, 10, 9, 7, 8, 8, 5, 7, 11, 10, 11, 8};
+        // BPC_SYM_* codes, with the 1-bit flag in front of every non-zero plane
+        static const unsigned SYM_CODE_SIZE[BPC_SYMS] = {1+3, 1+4, 1+7, 1+9, 1+33, 1+10, 1+9, 1+11};
 
+        UINT8 label[32];
+        UINT32 planes = bpc_classify_planes(dbx->dword, dbp->dword, label);
         unsigned length = 0;
-        run_length = 0;
-        for (int i=_MAX_DWORDS_PER_LINE-1; i>=0; i--) {
-            if (dbx->dword[i]==0) {
-                run_length++;
-            }
-            else {
-                if (run_length>0) {
-                    countPattern(run_length-1);
-                    assert(run_length!=32);
-                    length += ZRL_CODE_SIZE[run_length] + 1; //ESHA
-                }
-                run_length = 0;
-//ESHA
-//MIKE: 2/14/19, Removing Line Bug
-                if(false && line->dword[i]==0) {
-                    length += 1;
-                    countPattern(512);
-                }
-                else {
-                    length += 1;
-                    if (dbx->dword[i]==1) {
-                        length += 3;
-                        countPattern(32);
-                    } else if (dbp->dword[i]==0) {
-                        length += 4;
-                        countPattern(33);
-                    } else if (dbx->dword[i]==0xffffffff) {
-                        length += 7;
-                        countPattern(34);
-                    } else if (dbx->dword[i]==0xfffffffe) {
-                        length += 9;
-                        countPattern(35);
-                    } else {
-                        int oneCnt = 0;
-                        for (int j=0; j<32; j++) {
-                            if ((dbx->dword[i]>>j)&1) {
-                                oneCnt++;
-                            }
-                        }
-                        unsigned two_distance = 0;
-                        int firstPos = -1;
-                        if (oneCnt<=2) {
-                            for (int j=0; j<32; j++) {
-                                if ((dbx->dword[i]>>j)&1) {
-                                    if (firstPos==-1) {
-                                        firstPos = j;
-                                    } else {
-                                        two_distance = j - firstPos;
-                                    }
-                                }
-                            }
-                        }
-                        if (oneCnt==1) {
-                            length += 10;
-                            countPattern(64+firstPos);
-                        } else if ((oneCnt==2) && (firstPos==0)) {
-                            length += 9;
-                            countPattern(96+firstPos);
-                        } else if ((oneCnt==2) && (two_distance==1)) {
-                            length += 11;
-                            countPattern(128+firstPos);
-                        } else {
-                            length += 33;
-                            countPattern(36);
-                        }
-                    }
-                }
+        int above = _MAX_DWORDS_PER_LINE;   // last non-zero plane coded
+        while (planes!=0) {
+            int i = 31-__builtin_clz(planes);
+            planes &= ~(1u<<i);
+            run_length = above-1-i;
+            if (run_length>0) {
+                countPattern(run_length-1);
+                assert(run_length!=32);
+                length += ZRL_CODE_SIZE[run_length] + 1; //ESHA
             }
+            length += SYM_CODE_SIZE[label[i]];
+            countPattern(bpcPatternOf(label[i], dbx->dword[i]));
+            above = i;
         }
+        run_length = above;
         if (run_length>0) {
             length += ZRL_CODE_SIZE[run_length];
             countPattern(run_length-1);
@@ -451,7 +516,33 @@ public:
         }
         return length;
     }
-    unsigned encode_paper2(CACHELINE_DATA *dbx, CACHELINE_DATA *dbp) {
+    // encode_paper() with trained code lengths (BPCCodeTable.hh)
+    unsigned encode_table(BITPLANE_DATA *dbx, BITPLANE_DATA *dbp) {
+        static const unsigned PAYLOAD[BPC_SYMS] = {0, 0, 0, 0, 32, BPC_POS_BITS, BPC_POS_BITS, BPC_POS_BITS};
+        UINT8 label[32];
+        UINT32 planes = bpc_classify_planes(dbx->dword, dbp->dword, label);
+        unsigned length = 0;
+        int above = _MAX_DWORDS_PER_LINE;
+        while (planes!=0) {
+            int i = 31-__builtin_clz(planes);
+            planes &= ~(1u<<i);
+            run_length = above-1-i;
+            if (run_length>0) {
+                countPattern(run_length-1);
+                length += codes->run[run_length];
+            }
+            length += codes->sym[label[i]] + PAYLOAD[label[i]];
+            countPattern(bpcPatternOf(label[i], dbx->dword[i]));
+            above = i;
+        }
+        run_length = above;
+        if (run_length>0) {
+            length += codes->run[run_length];
+            countPattern(run_length-1);
+        }
+        return length;
+    }
+    unsigned encode_paper2(BITPLANE_DATA *dbx, BITPLANE_DATA *dbp) {
         //static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 8, 6, 8, 11, 7, 7, 9, 10, 9, 8, 9, 9, 10, 10, 10, 11, 9, 9, 10, 5, 8, 9, 10, 11, 11, 6, 9, 7, 10, 8, 10};
         //static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 6, 7, 8, 9, 6, 10, 12, 12, 8, 8, 9, 10, 9, 11, 11, 9, 9, 9, 10, 11, 10, 9, 7, 8, 8, 5, 7, 11, 10, 11, 8};
         static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 6, 7, 9, 8, 5, 9, 11, 11, 8, 8, 10, 10, 9, 11, 12, 9, 8, 8, 9, 10, 10, 10, 10, 8, 7, 5, 6, 9, 8, 6, 6};
@@ -517,12 +608,192 @@ public:
         }
         return length;
     }
+
+    // trained code lengths for code_mode 10, NULL for the paper's codes
+    bool trainable() const { return code_mode==10; }
+    BPC_CODE_TABLE trainCodeTable() const {
+        return bpcTrainTable(getPatternCounts(), _MAX_DWORDS_PER_LINE, (1u<<BPC_SYMS)-1);
+    }
+    void setCodeTable(const BPC_CODE_TABLE *table) { codes = table; name += "_T"; }
+
+    // BPC bitstream (code_mode 12: diff_mode 5, bp_mode 4)
+    // base (first dword)
+    // 000      -> zero
+    // 001      -> 4-bit sign-extended
+    // 010      -> 8-bit sign-extended
+    // 011      -> 16-bit sign-extended
+    // 1        -> uncompressed
+    // DBX planes from 31 to 0
+    // 1        -> uncompressed
+    // 01       -> Z-RLE: 2~33 (+5-bit)
+    // 001      -> Z-RLE: 1
+    // 00000    -> All 1's
+    // 00001    -> zero DBP
+    // 00010    -> consecutive two 1's (+position)
+    // 00011    -> single 1 (+position)
+    static const unsigned PLANE_BITS = _MAX_DWORDS_PER_LINE-1;
+    static const UINT32 PLANE_MASK = (1u<<PLANE_BITS)-1;
+    static const unsigned POS_BITS = (PLANE_BITS<=8) ? 3 : (PLANE_BITS<=16) ? 4 : 5;
+
+    unsigned encode_bitstream(UINT32 base, BITPLANE_DATA *dbx, BITPLANE_DATA *dbp, BitWriter &out, bool count) {
+        assert((diff_mode==5) && (bp_mode==4));
+
+        INT32 sym = base;
+        if (sym==0) {
+            if (count) countPattern(256);
+            out.put(0x0, 3);
+        } else if (sign_extended(sym, 4)) {
+            if (count) countPattern(257);
+            out.put(0x1, 3);
+            out.put(sym, 4);
+        } else if (sign_extended(sym, 8)) {
+            if (count) countPattern(258);
+            out.put(0x2, 3);
+            out.put(sym, 8);
+        } else if (sign_extended(sym, 16)) {
+            if (count) countPattern(259);
+            out.put(0x3, 3);
+            out.put(sym, 16);
+        } else {
+            if (count) countPattern(263);
+            out.put(0x1, 1);
+            out.put(sym, 32);
+        }
+
+        unsigned run = 0;
+        for (int i=31; i>=-1; i--) {
+            if ((i>=0) && (dbx->dword[i]==0)) {
+                run++;
+                continue;
+            }
+            if (run>0) {
+                if (count) countPattern(run-1);
+                if (run==1) {
+                    out.put(0x1, 3);
+                } else {
+                    out.put(0x1, 2);
+                    out.put(run-2, 5);
+                }
+                run = 0;
+            }
+            if (i<0) {
+                break;
+            }
+
+            UINT32 plane = dbx->dword[i];
+            int firstPos = __builtin_ctz(plane);
+            if (dbp->dword[i]==0) {
+                if (count) countPattern(33);
+                out.put(0x01, 5);
+            } else if (plane==PLANE_MASK) {
+                if (count) countPattern(34);
+                out.put(0x00, 5);
+            } else if (__builtin_popcount(plane)==1) {
+                if (count) countPattern(64+firstPos);
+                out.put(0x03, 5);
+                out.put(firstPos, POS_BITS);
+            } else if ((plane>>firstPos)==3) {
+                if (count) countPattern(128+firstPos);
+                out.put(0x02, 5);
+                out.put(firstPos, POS_BITS);
+            } else {
+                if (count) countPattern(36);
+                out.put(0x1, 1);
+                out.put(plane, PLANE_BITS);
+            }
+        }
+        return out.getLength();
+    }
+
+    // writes the BPC bitstream of a line into buf (_MAX_BYTES_PER_LINE bytes)
+    // and returns its length in bits
+    // : a line that does not compress is stored as is with length LSIZE,
+    //   the same length compressLine reports when frag_mode>=4
+    LENGTH encodeLine(CACHELINE_DATA *line, UINT8 *buf) {
+        CACHELINE_DATA diff_buffer;
+        CACHELINE_DATA *diff_result = transform(line, diff_buffer);
+
+        BITPLANE_DATA bp_buffer, dbp_buffer, dbx_buffer, dbx2_buffer;
+        bitplanes(line, diff_result, bp_buffer, dbp_buffer, dbx_buffer, dbx2_buffer);
+
+        BitWriter out(buf, LSIZE);
+        encode_bitstream(diff_result->dword[0], &dbx_buffer, &dbp_buffer, out, false);
+        LENGTH length = out.flush();
+        if (length >= LSIZE) {
+            memcpy(buf, line, _MAX_BYTES_PER_LINE);
+            return LSIZE;
+        }
+        return length;
+    }
+
+    // rebuilds a line from encodeLine's output
+    void decodeLine(const UINT8 *buf, LENGTH length, CACHELINE_DATA *line) {
+        if (length >= LSIZE) {
+            memcpy(line, buf, _MAX_BYTES_PER_LINE);
+            return;
+        }
+        BitReader in(buf);
+
+        UINT32 base;
+        if (in.get(1)) {
+            base = in.get(32);
+        } else {
+            static const unsigned BASE_BITS[4] = {0, 4, 8, 16};
+            unsigned size = BASE_BITS[in.get(2)];
+            base = (size==0) ? 0 : (UINT32) (((INT32) (in.get(size) << (32-size))) >> (32-size));
+        }
+
+        // DBP[i] = DBX[i] ^ DBP[i+1]
+        BITPLANE_DATA dbp;
+        UINT32 prev = 0;
+        for (int i=31; i>=0; ) {
+            UINT32 plane;
+            if (in.get(1)) {
+                plane = in.get(PLANE_BITS);
+            } else if (in.get(1)) {
+                for (unsigned run=in.get(5)+2; run>0; run--) {
+                    dbp.dword[i--] = prev;
+                }
+                continue;
+            } else if (in.get(1)) {
+                dbp.dword[i--] = prev;
+                continue;
+            } else {
+                unsigned code = in.get(2);
+                if (code==0) {
+                    plane = PLANE_MASK;
+                } else if (code==1) {
+                    prev = 0;
+                    dbp.dword[i--] = 0;
+                    continue;
+                } else if (code==2) {
+                    plane = 3u << in.get(POS_BITS);
+                } else {
+                    plane = 1u << in.get(POS_BITS);
+                }
+            }
+            prev ^= plane;
+            dbp.dword[i--] = prev;
+        }
+
+        // plane bit k holds dword k+1
+        UINT32 delta[_MAX_DWORDS_PER_LINE];
+        for (int i=0; i<32; i++) {
+            dbp.dword[i] <<= 1;
+        }
+        bp_inverse_transpose(dbp.dword, delta);
+        line->dword[0] = base;
+        for (int i=1; i<_MAX_DWORDS_PER_LINE; i++) {
+            line->dword[i] = line->dword[i-1] + delta[i];
+        }
+    }
 protected:
     // zero run length counters
     int diff_mode;
     int bp_mode;
     int code_mode;
     int frag_mode;
+    const BPC_CODE_TABLE *codes;    // trained code lengths, NULL for the paper's
 
     INT32 prev_data;
     INT32 prev_delta;
@@ -531,9 +802,90 @@ protected:
     bool prev_zero;
 };
 
-class BPCompressor : public ECompressor {
+// BPSCompressorDW with the diff, bp and code modes fixed at compile time:
+// the mode checks fold away and only the DBP / DBX planes are built.
+// Lengths and statistics are the same as BPSCompressorDW's.
+template<int DIFF, int BP, int CODE>
+class BPSCompressorDWT : public BPSCompressorDW {
+public:
+    BPSCompressorDWT(const string name, int fragblocks) : BPSCompressorDW(name, DIFF, BP, CODE, fragblocks) {}
+    Compressor *clone() const { return new BPSCompressorDWT(*this); }
+    COMPRESS_LINES(BPSCompressorDWT)
+
+    unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
+        PHASE_BEGIN(t);
+        CACHELINE_DATA diff_buffer;
+        CACHELINE_DATA *diff_result = transformMode<DIFF>(line, diff_buffer);
+        PHASE_END(PHASE_TRANSFORM, t);
+
+        BITPLANE_DATA dbp_buffer, dbx_buffer;
+        planesMode<BP>(diff_result, dbp_buffer, dbx_buffer);
+        PHASE_END(PHASE_BITPLANE, t);
+
+        unsigned blkLength = encodeMode<CODE>(line, diff_result, &dbx_buffer, &dbp_buffer);
+        PHASE_END(PHASE_ENCODE, t);
+
+        blkLength = fragment(blkLength);
+        countLineResult(blkLength);
+        PHASE_END(PHASE_FRAG, t);
+
+        return blkLength;
+    }
+};
+
+// code 12 (the bitstream) exists for diff 5 / bp 4 only
+template<int DIFF, int BP>
+struct BPSCompressorDWBitstream {
+    static BPSCompressorDW *create(const string name, int fragblocks) { return NULL; }
+};
+template<>
+struct BPSCompressorDWBitstream<5, 4> {
+    static BPSCompressorDW *create(const string name, int fragblocks) { return new BPSCompressorDWT<5, 4, 12>(name, fragblocks); }
+};
+
+template<int DIFF, int BP>
+BPSCompressorDW *createBPSCompressorDWCode(const string name, int code, int fragblocks) {
+    switch (code) {
+        case 10: return new BPSCompressorDWT<DIFF, BP, 10>(name, fragblocks);
+        case 11: return new BPSCompressorDWT<DIFF, BP, 11>(name, fragblocks);
+        case 12: return BPSCompressorDWBitstream<DIFF, BP>::create(name, fragblocks);
+    }
+    return NULL;
+}
+
+template<int DIFF>
+BPSCompressorDW *createBPSCompressorDWBP(const string name, int bp, int code, int fragblocks) {
+    switch (bp) {
+        case 0: return createBPSCompressorDWCode<DIFF, 0>(name, code, fragblocks);
+        case 1: return createBPSCompressorDWCode<DIFF, 1>(name, code, fragblocks);
+        case 2: return createBPSCompressorDWCode<DIFF, 2>(name, code, fragblocks);
+        case 3: return createBPSCompressorDWCode<DIFF, 3>(name, code, fragblocks);
+        case 4: return createBPSCompressorDWCode<DIFF, 4>(name, code, fragblocks);
+    }
+    return NULL;
+}
+
+// the specialized class for a runtime configuration; BPSCompressorDW itself
+// for combinations without one
+BPSCompressorDW *createBPSCompressorDW(const string name, int diff, int bp, int code, int fragblocks) {
+    BPSCompressorDW *comp = NULL;
+    switch (diff) {
+        case 0: comp = createBPSCompressorDWBP<0>(name, bp, code, fragblocks); break;
+        case 1: comp = createBPSCompressorDWBP<1>(name, bp, code, fragblocks); break;
+        case 2: comp = createBPSCompressorDWBP<2>(name, bp, code, fragblocks); break;
+        case 3: comp = createBPSCompressorDWBP<3>(name, bp, code, fragblocks); break;
+        case 4: comp = createBPSCompressorDWBP<4>(name, bp, code, fragblocks); break;
+        case 5: comp = createBPSCompressorDWBP<5>(name, bp, code, fragblocks); break;
+        case 6: comp = createBPSCompressorDWBP<6>(name, bp, code, fragblocks); break;
+    }
+    return (comp!=NULL) ? comp : new BPSCompressorDW(name, diff, bp, code, fragblocks);
+}
+
+class BPCompressor : public Compressor {
 public:
-    BPCompressor(const string name) : ECompressor(name) {}
+    BPCompressor(const string name) : Compressor(name) {}
+    Compressor *clone() const { return new BPCompressor(*this); }
+    COMPRESS_LINES(BPCompressor)
     unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
         INT64 deltas[31];
         for (int i=1; i<_MAX_DWORDS_PER_LINE; i++) {
@@ -732,14 +1084,16 @@ public:
     }
 };
 
-class BPSCompressor64 : public ECompressor {
+class BPSCompressor64 : public Compressor {
     public:
         BPSCompressor64(const string name, int diff, int bp, int code, int fragblocks)
-            : ECompressor(name), diff_mode(diff), bp_mode(bp), code_mode(code), frag_mode(fragblocks){}
+            : Compressor(name), diff_mode(diff), bp_mode(bp), code_mode(code), frag_mode(fragblocks), codes(NULL) {}
         ~BPSCompressor64() {}
+        Compressor *clone() const { return new BPSCompressor64(*this); }
+        COMPRESS_LINES(BPSCompressor64)
     public:
         void reset() {
-            ECompressor::reset();
+            Compressor::reset();
 
             prev_zero = true;
             prev_data = 0;
@@ -749,6 +1103,11 @@ class BPSCompressor64 : public ECompressor {
             run_length = 0;
             run_length_orig = 0;
         }
+        void seed(CACHELINE_DATA* line) {
+            if (diff_mode==2) {
+                prev_data = line->dword[_MAX_DWORDS_PER_LINE-1];
+            }
+        }
 
         CACHELINE_DATA* transform(CACHELINE_DATA* line, CACHELINE_DATA &buffer) {
             if (diff_mode==2) {       // XOR
@@ -760,18 +1119,29 @@ class BPSCompressor64 : public ECompressor {
             return &buffer;
         }
         unsigned compressLine(CACHELINE_DATA* line, UINT64 line_addr) {
+            PHASE_BEGIN(t);
             CACHELINE_DATA diff_buffer;
             CACHELINE_DATA *diff_result = transform(line, diff_buffer);
+            PHASE_END(PHASE_TRANSFORM, t);
 
             // BP mode
-            //TODO: These sizes need to be changed for a smaller cache line size
-            CACHELINE_DATA bp_buffer = {};
-            CACHELINE_DATA dbp_buffer = {};
-            CACHELINE_DATA dbx_buffer = {};
-            CACHELINE_DATA dbx2_buffer = {};
+            // 32 planes of _MAX_DWORDS_PER_LINE bits (setPlane) fill a line
+            CACHELINE_DATA dbp_buffer, dbx_buffer;
             CACHELINE_DATA *bp_result = NULL;
+            if (bp_mode!=4) {       // otherwise every plane is written
+                memset(&dbp_buffer, 0, sizeof(dbp_buffer));
+                memset(&dbx_buffer, 0, sizeof(dbx_buffer));
+            }
 
-            if (bp_mode==4) {
+            if ((bp_mode==4) && (bp_transpose!=NULL)) {
+                BITPLANE_DATA dbp_planes, dbx_planes;
+                bp_build_planes(diff_result->dword, dbp_planes.dword, dbx_planes.dword, NULL);
+                for (int j=0; j<32; j++) {  // first dword excluded
+                    setPlane(&dbp_buffer, j, dbp_planes.dword[j]>>1);
+                    setPlane(&dbx_buffer, j, dbx_planes.dword[j]>>1);
+                }
+                bp_result = &dbx_buffer;
+            } else if (bp_mode==4) {
                 for (int j=31; j>=0; j--) {
                     INT32 bufDBP = 0;
                     INT32 bufDBX = 0;
@@ -785,26 +1155,104 @@ class BPSCompressor64 : public ECompressor {
                             bufDBX  |= (((diff_result->dword[i]>>j)^(diff_result->dword[i]>>(j+1)))&1);
                         }
                     }
-                    dbp_buffer.word[j]  = bufDBP;
-                    dbx_buffer.word[j]  = bufDBX;
+                    setPlane(&dbp_buffer, j, bufDBP);
+                    setPlane(&dbx_buffer, j, bufDBX);
                 }
                 bp_result = &dbx_buffer;
             }
+            PHASE_END(PHASE_BITPLANE, t);
             unsigned blkLength = 0;
             if (code_mode==10) {
-                blkLength = encode_paper(&dbx_buffer, &dbp_buffer, line);
+                blkLength = (codes!=NULL) ? encode_table(&dbx_buffer, &dbp_buffer, line) : encode_paper(&dbx_buffer, &dbp_buffer, line);
             }
+            PHASE_END(PHASE_ENCODE, t);
             countLineResult(blkLength);
 
             return blkLength;
         }
+        // plane j (bits of dwords 1.._MAX_DWORDS_PER_LINE-1) in its slot of a line
+        static void setPlane(CACHELINE_DATA *planes, int j, UINT32 bits) {
+            switch (_MAX_DWORDS_PER_LINE) {
+                case 8:  planes->byte[j] = bits; break;
+                case 16: planes->word[j] = bits; break;
+                default: planes->dword[j] = bits; break;
+            }
+        }
+
+        // trained code lengths for code_mode 10, NULL for the paper's codes
+        bool trainable() const { return code_mode==10; }
+        BPC_CODE_TABLE trainCodeTable() const {
+            UINT32 syms = (1u<<BPC_SYM_DBP_ZERO) | (1u<<BPC_SYM_ALL_ONES) | (1u<<BPC_SYM_RAW) | (1u<<BPC_SYM_SINGLE) | (1u<<BPC_SYM_CONSECUTIVE);
+            return bpcTrainTable(getPatternCounts(), _MAX_DWORDS_PER_LINE, syms);
+        }
+        void setCodeTable(const BPC_CODE_TABLE *table) { codes = table; name += "_T"; }
+
+        // encode_paper() with trained code lengths (BPCCodeTable.hh)
+        unsigned encode_table(CACHELINE_DATA *dbx, CACHELINE_DATA *dbp, CACHELINE_DATA *line) {
+            unsigned length = 0;
+            run_length = 0;
+            run_length_orig = 0;
+            for (int i=_MAX_DWORDS_PER_LINE-1; i>=0; i--) {
+                UINT32 plane = dbx->dword[i];
+                if (plane==0) {
+                    run_length++;
+                    continue;
+                } else if ((run_length==0) && (line->dword[i]==0)) {
+                    run_length_orig++;
+                    continue;
+                }
+                if ((run_length>0) || (run_length_orig>0)) {
+                    int run_len = run_length+run_length_orig;
+                    countPattern(run_len-1);
+                    length += codes->run[run_len];
+                }
+                run_length = 0;
+                run_length_orig = 0;
+                if (line->dword[i]==0) {
+                    run_length_orig++;
+                    continue;
+                }
+                int firstPos = __builtin_ctz(plane);
+                int oneCnt = __builtin_popcount(plane);
+                if (dbp->dword[i]==0) {
+                    length += codes->sym[BPC_SYM_DBP_ZERO];
+                    countPattern(33);
+                } else if (plane==0xffffffff) {
+                    length += codes->sym[BPC_SYM_ALL_ONES];
+                    countPattern(34);
+                } else if (oneCnt==1) {
+                    length += codes->sym[BPC_SYM_SINGLE] + BPC_POS_BITS;
+                    countPattern(64+firstPos);
+                } else if ((oneCnt==2) && ((plane>>firstPos)==3)) {
+                    length += codes->sym[BPC_SYM_CONSECUTIVE] + BPC_POS_BITS;
+                    countPattern(128+firstPos);
+                } else {
+                    // a dword holds 32/_MAX_DWORDS_PER_LINE planes of _MAX_DWORDS_PER_LINE-1 bits
+                    length += codes->sym[BPC_SYM_RAW] + 32/_MAX_DWORDS_PER_LINE*(_MAX_DWORDS_PER_LINE-1);
+                    countPattern(36);
+                }
+            }
+            if ((run_length>0) || (run_length_orig>0)) {
+                int run_len = run_length+run_length_orig;
+                length += codes->run[run_len];
+                countPattern(run_len-1);
+            }
+            if ((run_length==_MAX_DWORDS_PER_LINE) || (run_length_orig==_MAX_DWORDS_PER_LINE)) {
+                length = 0;
+            }
+            return length;
+        }
 
         unsigned encode_paper(CACHELINE_DATA *dbx, CACHELINE_DATA *dbp, CACHELINE_DATA *line) {
             //static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 8, 6, 8, 11, 7, 7, 9, 10, 9, 8, 9, 9, 10, 10, 10, 11, 9, 9, 10, 5, 8, 9, 10, 11, 11, 6, 9, 7, 10, 8, 10};
 
-            //static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 6, 7, 8, 9, 6, 10, 12, 12, 8, 8, 9, 10, 9, 11, 11, 9, 9, 9, 10, 11, 10, 9, 7, 8, 8, 5, 7, 11, 10, 11, 8};
-
+            // runs of up to _MAX_DWORDS_PER_LINE: the 64B codes up to 64B lines
+#if (LSIZE > 512)
+            static const unsigned ZRL_CODE_SIZE[33] = {0, 4, 6, 7, 8, 9, 6, 10, 12, 12, 8, 8, 9, 10, 9, 11, 11, 9, 9, 9, 10, 11, 10, 9, 7, 8, 8, 5, 7, 11, 10, 11, 8};
+#else
             static const unsigned ZRL_CODE_SIZE[17] = {0, 4, 6, 7, 8, 7, 6, 8, 8, 8, 8, 9, 9, 9, 9, 7, 5 };
+#endif
+            static_assert(sizeof(ZRL_CODE_SIZE)/sizeof(ZRL_CODE_SIZE[0]) > _MAX_DWORDS_PER_LINE, "a code for every run length");
             //	static const unsigned ZRL_CODE_SIZE[17] = {0, 3, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7 };
             unsigned length = 0;
             run_length = 0;
@@ -876,7 +1324,7 @@ class BPSCompressor64 : public ECompressor {
                 length += ZRL_CODE_SIZE[run_len]+1;
                 countPattern(run_len-1);
             }
-            if(run_length==16 || run_length_orig==16){
+            if(run_length==_MAX_DWORDS_PER_LINE || run_length_orig==_MAX_DWORDS_PER_LINE){
                     length = 0;	
             }
             //	cout << " " << length;
@@ -888,6 +1336,7 @@ class BPSCompressor64 : public ECompressor {
         int bp_mode;
         int code_mode;
         int frag_mode;
+        const BPC_CODE_TABLE *codes;    // trained code lengths, NULL for the paper's
 
         INT32 prev_data;
         INT32 prev_delta;
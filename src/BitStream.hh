@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+
+#ifndef __BIT_STREAM_HH__
+#define __BIT_STREAM_HH__
+
+#include "common.hh"
+
+//--------------------------------------------------------------------
+// MSB-first bit packer for compressed lines
+// : buf may be NULL to only count bits; bits beyond capacity are counted
+//   but not stored (a line that does not fit is kept uncompressed anyway)
+class BitWriter {
+    public:
+        BitWriter(UINT8 *_buf, LENGTH _capacity)
+        : buf(_buf), capacity(_capacity/8), pos(0), length(0), acc(0ull), accBits(0) {}
+    public:
+        // appends the low nbits (<=32) of value
+        void put(UINT32 value, unsigned nbits) {
+            acc = (acc << nbits) | (value & ((1ull << nbits) - 1));
+            accBits += nbits;
+            length += nbits;
+            while (accBits >= 8) {
+                accBits -= 8;
+                emit((UINT8) (acc >> accBits));
+            }
+        }
+        // pads the last byte with zeros, returns the length in bits
+        LENGTH flush() {
+            if (accBits > 0) {
+                emit((UINT8) (acc << (8-accBits)));
+                accBits = 0;
+            }
+            return length;
+        }
+        LENGTH getLength() const { return length; }
+    protected:
+        void emit(UINT8 byte) {
+            if ((buf!=NULL) && (pos<capacity)) {
+                buf[pos] = byte;
+            }
+            pos++;
+        }
+    protected:
+        UINT8 *buf;
+        LENGTH capacity;    // in bytes
+        LENGTH pos;
+        LENGTH length;
+        UINT64 acc;
+        unsigned accBits;
+};
+
+class BitReader {
+    public:
+        BitReader(const UINT8 *_buf) : buf(_buf), pos(0), acc(0ull), accBits(0) {}
+    public:
+        // reads nbits (<=32)
+        UINT32 get(unsigned nbits) {
+            while (accBits < nbits) {
+                acc = (acc << 8) | buf[pos++];
+                accBits += 8;
+            }
+            accBits -= nbits;
+            return (UINT32) ((acc >> accBits) & ((1ull << nbits) - 1));
+        }
+    protected:
+        const UINT8 *buf;
+        LENGTH pos;
+        UINT64 acc;
+        unsigned accBits;
+};
+
+//--------------------------------------------------------------------
+#endif /* __BIT_STREAM_HH__ */
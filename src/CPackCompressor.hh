@@ -29,80 +29,232 @@
 #define __CPACK_COMPRESSOR_HH__
 
 #include "common.hh"
+#include "BitStream.hh"
 
+// define CPACK_NO_SIMD to always use the scalar dictionary match
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(CPACK_NO_SIMD)
+#define CPACK_SIMD
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Match of one dword against a dictionary (entries: multiple of 8)
+//   bit j of match[0]: entry j == value
+//   bit j of match[1]: upper 3 bytes equal
+//   bit j of match[2]: upper 2 bytes equal
+typedef void (*CPACK_MATCH_FUNC)(UINT32 value, const UINT32 *dict, int entries, UINT64 *match);
+
+static void cpack_match_scalar(UINT32 value, const UINT32 *dict, int entries, UINT64 *match) {
+    match[0] = match[1] = match[2] = 0ull;
+    for (int j=0; j<entries; j++) {
+        UINT32 diff = value ^ dict[j];
+        if ((diff&0xFFFF0000)==0) {
+            match[2] |= 1ull << j;
+            if ((diff&0xFFFFFF00)==0) {
+                match[1] |= 1ull << j;
+                if (diff==0) {
+                    match[0] |= 1ull << j;
+                }
+            }
+        }
+    }
+}
+
+#ifdef CPACK_SIMD
+__attribute__((target("sse2")))
+static void cpack_match_sse2(UINT32 value, const UINT32 *dict, int entries, UINT64 *match) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask3 = _mm_set1_epi32(0xFFFFFF00);
+    __m128i v = _mm_set1_epi32(value);
+    match[0] = match[1] = match[2] = 0ull;
+    for (int k=0; k<entries/4; k++) {
+        __m128i diff = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *) &dict[k*4]));
+        __m128i full = _mm_cmpeq_epi32(diff, zero);
+        __m128i m3 = _mm_cmpeq_epi32(_mm_and_si128(diff, mask3), zero);
+        __m128i m2 = _mm_cmpeq_epi32(_mm_srli_epi32(diff, 16), zero);
+        match[0] |= ((UINT64) _mm_movemask_ps(_mm_castsi128_ps(full))) << (k*4);
+        match[1] |= ((UINT64) _mm_movemask_ps(_mm_castsi128_ps(m3))) << (k*4);
+        match[2] |= ((UINT64) _mm_movemask_ps(_mm_castsi128_ps(m2))) << (k*4);
+    }
+}
+
+__attribute__((target("avx2")))
+static void cpack_match_avx2(UINT32 value, const UINT32 *dict, int entries, UINT64 *match) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mask3 = _mm256_set1_epi32(0xFFFFFF00);
+    __m256i v = _mm256_set1_epi32(value);
+    match[0] = match[1] = match[2] = 0ull;
+    for (int k=0; k<entries/8; k++) {
+        __m256i diff = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *) &dict[k*8]));
+        __m256i full = _mm256_cmpeq_epi32(diff, zero);
+        __m256i m3 = _mm256_cmpeq_epi32(_mm256_and_si256(diff, mask3), zero);
+        __m256i m2 = _mm256_cmpeq_epi32(_mm256_srli_epi32(diff, 16), zero);
+        match[0] |= ((UINT64) _mm256_movemask_ps(_mm256_castsi256_ps(full))) << (k*8);
+        match[1] |= ((UINT64) _mm256_movemask_ps(_mm256_castsi256_ps(m3))) << (k*8);
+        match[2] |= ((UINT64) _mm256_movemask_ps(_mm256_castsi256_ps(m2))) << (k*8);
+    }
+}
+#endif
+
+static CPACK_MATCH_FUNC cpack_select_match() {
+#ifdef CPACK_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return cpack_match_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return cpack_match_sse2;
+    }
+#endif
+    return cpack_match_scalar;
+}
+
+static CPACK_MATCH_FUNC cpack_match = cpack_select_match();
+
+//------------------------------------------------------------------------------
+// C-Pack with a per-line FIFO dictionary of 8/16/32/64 entries
+//   00  : zzzz                     01  : xxxx + 32b (pushed to the dictionary)
+//   10  : mmmm + index             1100: mmxx + index + 16b
+//   1101: zzzx + 8b                1110: mmmx + index + 8b
 class CPackCompressor: public Compressor {
 public:
-    CPackCompressor(): Compressor("C-Pack64") {}
+    CPackCompressor(): Compressor("C-Pack64"), dictSize(16), indexBits(4) {}
+    CPackCompressor(string name, int _dictSize): Compressor(name), dictSize(_dictSize), indexBits(__builtin_ctz(_dictSize)) {
+        assert((dictSize==8) || (dictSize==16) || (dictSize==32) || (dictSize==64));
+    }
+    Compressor *clone() const { return new CPackCompressor(*this); }
+    COMPRESS_LINES(CPackCompressor)
 
     // external interface
 public:
     LENGTH compressLine(CACHELINE_DATA *line, UINT64 line_addr) {
         LENGTH blkLength = 0;
 
-        int wrPtr = 0;
-        for (int i=0; i<16; i++) {
-            dictionary[i] = 0;
+        resetDictionary();
+        for (UINT32 i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            int index;
+            int code = matchDword(line->dword[i], &index);
+            countPattern(code);
+            blkLength += codeLength(code);
         }
 
+        countLineResult(blkLength);
+
+        return blkLength;
+    }
+
+    // writes the codes of a line to buf (_MAX_BYTES_PER_LINE bytes) and returns
+    // the length in bits; lines that do not shrink are stored raw as LSIZE bits
+    LENGTH encodeLine(CACHELINE_DATA *line, UINT8 *buf) {
+        BitWriter out(buf, LSIZE);
+
+        resetDictionary();
         for (UINT32 i=0; i<_MAX_DWORDS_PER_LINE; i++) {
-            // code 00: zzzz
-            if (line->dword[i]==0) {
-                countPattern(0);
-                blkLength+=2;
+            UINT32 value = line->dword[i];
+            int index;
+            switch (matchDword(value, &index)) {
+                case 0:  out.put(0x0, 2);                                               break;
+                case 1:  out.put(0x1, 2);  out.put(value, 32);                          break;
+                case 2:  out.put(0x2, 2);  out.put(index, indexBits);                   break;
+                case 12: out.put(0xC, 4);  out.put(index, indexBits); out.put(value, 16); break;
+                case 13: out.put(0xD, 4);  out.put(value, 8);                           break;
+                case 14: out.put(0xE, 4);  out.put(index, indexBits); out.put(value, 8);  break;
             }
-            else {
-                bool matchedFull = false;
-                bool matched3B = false;
-                bool matched2B = false;
-                for (int j=0; j<16; j++) {
-                    if (line->dword[i]==dictionary[j]) {
-                        matchedFull = true;
-                    }
-                    if ((line->dword[i]&0xFFFFFF00)==(dictionary[j]&0xFFFFFF00)) {
-                        matched3B = true;
-                    }
-                    if ((line->dword[i]&0xFFFF0000)==(dictionary[j]&0xFFFF0000)) {
-                        matched2B = true;
-                    }
-                }
+        }
+        LENGTH length = out.flush();
+        if (length >= LSIZE) {
+            memcpy(buf, line, _MAX_BYTES_PER_LINE);
+            return LSIZE;
+        }
+        return length;
+    }
 
-                // code 10: mmmm
-                if (matchedFull) {
-                    countPattern(2);
-                    blkLength+=6;
-                }
-                // code 1101: zzzx  -> 1101+8-bit
-                else if ((line->byte[i*4+3]==0)&&(line->byte[i*4+2]==0)&&(line->byte[i*4+1]==0)) {
-                    countPattern(13);
-                    blkLength+=12;
-                }
-                // code 1110: mmmx  -> 1110+4-bit+8-bit
-                else if (matched3B) {
-                    countPattern(14);
-                    blkLength+=16;
-                }
-                // code 1100: mmxx  -> 1100+4-bit+8-bitx2
-                else if (matched2B) {
-                    countPattern(12);
-                    blkLength+=24;
-                }
-                // code: 01: xxxx -> 34 bit
-                else {
-                    countPattern(1);
-                    blkLength+=34;
-                    dictionary[wrPtr] = line->dword[i];
-                    wrPtr = (wrPtr+1)%16;
-                }
-            }
+    // rebuilds a line from encodeLine's output
+    void decodeLine(const UINT8 *buf, LENGTH length, CACHELINE_DATA *line) {
+        if (length >= LSIZE) {
+            memcpy(line, buf, _MAX_BYTES_PER_LINE);
+            return;
         }
+        BitReader in(buf);
 
-        countLineResult(blkLength);
+        resetDictionary();
+        for (UINT32 i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            UINT32 value;
+            switch (in.get(2)) {
+                case 0x0: value = 0;                                        break;
+                case 0x1: value = in.get(32); pushDictionary(value);        break;
+                case 0x2: value = dictionary[in.get(indexBits)];            break;
+                default:
+                    switch (in.get(2)) {
+                        case 0x0: value = dictionary[in.get(indexBits)] & 0xFFFF0000;
+                                  value |= in.get(16);                      break;
+                        case 0x1: value = in.get(8);                        break;
+                        default:  value = dictionary[in.get(indexBits)] & 0xFFFFFF00;
+                                  value |= in.get(8);
+                    }
+            }
+            line->dword[i] = value;
+        }
+    }
 
-        return blkLength;
+protected:
+    void resetDictionary() {
+        for (int i=0; i<dictSize; i++) {
+            dictionary[i] = 0;
+        }
+        wrPtr = 0;
+    }
+    void pushDictionary(UINT32 value) {
+        dictionary[wrPtr] = value;
+        wrPtr = (wrPtr+1)%dictSize;
+    }
+    // returns the pattern ID (code above) and the matching dictionary index
+    int matchDword(UINT32 value, int *index) {
+        // code 00: zzzz
+        if (value==0) {
+            return 0;
+        }
+        UINT64 match[3];
+        cpack_match(value, dictionary, dictSize, match);
+        // code 10: mmmm
+        if (match[0]!=0) {
+            *index = __builtin_ctzll(match[0]);
+            return 2;
+        }
+        // code 1101: zzzx
+        if ((value&0xFFFFFF00)==0) {
+            return 13;
+        }
+        // code 1110: mmmx
+        if (match[1]!=0) {
+            *index = __builtin_ctzll(match[1]);
+            return 14;
+        }
+        // code 1100: mmxx
+        if (match[2]!=0) {
+            *index = __builtin_ctzll(match[2]);
+            return 12;
+        }
+        // code 01: xxxx
+        pushDictionary(value);
+        return 1;
+    }
+    LENGTH codeLength(int code) {
+        switch (code) {
+            case 0:  return 2;
+            case 2:  return 2+indexBits;
+            case 13: return 4+8;
+            case 14: return 4+indexBits+8;
+            case 12: return 4+indexBits+16;
+            default: return 2+32;
+        }
     }
 
 protected:
-    INT32 dictionary[16];
+    int dictSize;
+    int indexBits;
+    UINT32 dictionary[64];
+    int wrPtr;
 };
 
 #endif /* __CPACK_COMPRESSOR_HH__ */
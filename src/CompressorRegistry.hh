@@ -0,0 +1,245 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __COMPRESSOR_REGISTRY_HH__
+#define __COMPRESSOR_REGISTRY_HH__
+
+#include "common.hh"
+#include "BPCompressor.hh"
+#include "BDICompressor.hh"
+#include "CPackCompressor.hh"
+#include "FPCompressor.hh"
+#include "BPCSweep.hh"
+#include "ResultCache.hh"
+
+//--------------------------------------------------------------------
+// Compressors built from command-line specs (vsc -c <spec>)
+#define COMPRESSOR_SPECS \
+    "  bdi                          BDI (base8/4/2 + immediates)\n" \
+    "  bd                           base+delta without immediates\n" \
+    "  fpc                          FPC\n" \
+    "  cpack[:entries]              C-Pack, 8/16/32/64 dictionary entries (16)\n" \
+    "  bpsdw:diff,bp,code,frag      BPSCompressorDW modes: diff 0-6, bp 0-4, code 10/11\n" \
+    "                               (12 with diff 5 and bp 4), frag 0-2 or >=4\n" \
+    "  bps64:diff,bp,code,frag      BPSCompressor64 modes: 2,4,10,frag\n" \
+    "  bpsweep:diffs,bps,codes,frags  every BPSCompressorDW combination in one pass;\n" \
+    "                               each field a mode, a list (10/11) or a range (0-6)\n"
+
+// modes a BPS compressor implements (dw: BPSCompressorDW, else BPSCompressor64)
+// : code 12 (the bitstream) needs diff 5 and bp 4
+// : BPSCompressor64 has only the XOR transform, DBX planes and the paper's codes
+// : frag 3 has no block_sizes row
+static bool validModes(bool dw, int diff, int bp, int code, int frag) {
+    if ((frag<0) || (frag==3)) {
+        return false;
+    }
+    if (!dw) {
+        return (diff==2) && (bp==4) && (code==10);
+    }
+    if ((diff<0) || (diff>6) || (bp<0) || (bp>4)) {
+        return false;
+    }
+    return (code==10) || (code==11) || ((code==12) && (diff==5) && (bp==4));
+}
+
+// modes of a bpsweep field: "a", "a/b/..." or "a-b"; false if malformed
+static bool parseModes(const string &field, vector<int> &modes) {
+    int lo, hi;
+    char end;
+    if (sscanf(field.c_str(), "%d-%d%c", &lo, &hi, &end)==2) {
+        for (int m=lo; m<=hi; m++) {
+            modes.push_back(m);
+        }
+        return lo<=hi;
+    }
+    istringstream in(field);
+    string mode;
+    while (getline(in, mode, '/')) {
+        if (sscanf(mode.c_str(), "%d%c", &lo, &end)!=1) {
+            return false;
+        }
+        modes.push_back(lo);
+    }
+    return !modes.empty();
+}
+
+// NULL if a field is malformed or no combination is valid
+// : combinations validModes() rejects are left out
+static Compressor *createSweep(const char *args) {
+    vector<int> modes[4];
+    istringstream in(args);
+    string field;
+    int f = 0;
+    while (getline(in, field, ',')) {
+        if ((f==4) || !parseModes(field, modes[f])) {
+            return NULL;
+        }
+        f++;
+    }
+    if (f!=4) {
+        return NULL;
+    }
+    BPSSweepDW *sweep = new BPSSweepDW("BPS-DW-Sweep");
+    char name[64];
+    for (int diff : modes[0]) {
+        for (int bp : modes[1]) {
+            for (int code : modes[2]) {
+                for (int frag : modes[3]) {
+                    if (!validModes(true, diff, bp, code, frag)) {
+                        continue;
+                    }
+                    snprintf(name, sizeof(name), "BPS-DW_%d_%d_%d_%d", diff, bp, code, frag);
+                    sweep->add(BPSCompressorDW(name, diff, bp, code, frag));
+                }
+            }
+        }
+    }
+    if (sweep->getConfigCount()==0) {
+        delete sweep;
+        return NULL;
+    }
+    return sweep;
+}
+
+// NULL if the spec is not recognized or its modes are not valid
+Compressor *createCompressor(const string &spec) {
+    string kind = spec.substr(0, spec.find(':'));
+    const char *args = (spec.find(':')==string::npos) ? "" : spec.c_str()+spec.find(':')+1;
+    int a[4];
+    char name[64];
+    char end;
+
+    if ((kind=="bdi") && (*args==0)) {
+        return new BDICompressorQW();
+    } else if ((kind=="bd") && (*args==0)) {
+        return new BDCompressorQW();
+    } else if ((kind=="fpc") && (*args==0)) {
+        return new FPCompressorDW();
+    } else if (kind=="cpack") {
+        if (*args==0) {
+            return new CPackCompressor();
+        }
+        if ((sscanf(args, "%d%c", &a[0], &end)==1) && ((a[0]==8) || (a[0]==16) || (a[0]==32) || (a[0]==64))) {
+            snprintf(name, sizeof(name), "C-Pack64_%d", a[0]);
+            return new CPackCompressor(name, a[0]);
+        }
+    } else if ((kind=="bpsdw") || (kind=="bps64")) {
+        if ((sscanf(args, "%d,%d,%d,%d%c", &a[0], &a[1], &a[2], &a[3], &end)==4) && validModes(kind=="bpsdw", a[0], a[1], a[2], a[3])) {
+            if (kind=="bpsdw") {
+                snprintf(name, sizeof(name), "BPS-DW_%d_%d_%d_%d", a[0], a[1], a[2], a[3]);
+                return createBPSCompressorDW(name, a[0], a[1], a[2], a[3]);
+            }
+            snprintf(name, sizeof(name), "BPS-64_%d_%d_%d_%d", a[0], a[1], a[2], a[3]);
+            return new BPSCompressor64(name, a[0], a[1], a[2], a[3]);
+        }
+    } else if (kind=="bpsweep") {
+        return createSweep(args);
+    }
+    return NULL;
+}
+
+//--------------------------------------------------------------------
+// Trained BPC code tables (BPCCodeTable.hh)
+// : tables loaded at start-up (vsc -T) come first, then the built-in ones
+// : tables are named <compressor>_<line bytes>B (bpcTableName)
+static vector<pair<string, BPC_CODE_TABLE> > loaded_code_tables;
+
+static const BPC_CODE_TABLE *findCodeTable(const string &name) {
+    string key = bpcTableName(name);
+    for (auto it = loaded_code_tables.cbegin(); it != loaded_code_tables.cend(); ++it) {
+        if (it->first==key) {
+            return &it->second;
+        }
+    }
+#ifdef BPC_CODE_TABLES
+    for (unsigned i=0; i<sizeof(BPC_TRAINED_TABLES)/sizeof(BPC_TRAINED_TABLES[0]); i++) {
+        if (key==BPC_TRAINED_TABLES[i].name) {
+            return BPC_TRAINED_TABLES[i].table;
+        }
+    }
+#endif
+    return NULL;
+}
+
+// switches a BPC compressor to the table trained for its name and line
+// size, if there is one; the compressor is renamed <name>_T
+void applyCodeTable(Compressor *comp) {
+    const BPC_CODE_TABLE *table = findCodeTable(comp->getName());
+    if (table==NULL) {
+        return;
+    }
+    if (!bpcTableCovers(*table)) {
+        fprintf(stderr, "code table %s has no code for some runs of up to %d planes, not used\n", bpcTableName(comp->getName()).c_str(), _MAX_DWORDS_PER_LINE);
+        return;
+    }
+    if (BPSCompressorDW *bpc = dynamic_cast<BPSCompressorDW *>(comp)) {
+        if (bpc->trainable()) {
+            bpc->setCodeTable(table);
+        }
+    } else if (BPSCompressor64 *bpc = dynamic_cast<BPSCompressor64 *>(comp)) {
+        if (bpc->trainable()) {
+            bpc->setCodeTable(table);
+        }
+    }
+}
+
+// configuration key of a compressor's entries in the result cache
+// (ResultCache.hh): its name, which spells out its modes, and the code table
+// it was switched to; 0 for sweeps, whose results are not cached
+UINT64 resultCacheConfig(const Compressor *comp) {
+    if (dynamic_cast<const BPSSweepDW *>(comp)!=NULL) {
+        return 0;
+    }
+    string name = comp->getName();
+    UINT64 h = cache_hash(name.data(), name.size());
+    if ((name.size()>2) && (name.compare(name.size()-2, 2, "_T")==0)) {
+        const BPC_CODE_TABLE *table = findCodeTable(name.substr(0, name.size()-2));
+        if (table!=NULL) {
+            h = cache_hash(table, sizeof(*table), h);
+        }
+    }
+    return (h==0) ? 1 : h;
+}
+
+// false if the compressor has no trainable coder
+bool trainCodeTable(const Compressor *comp, BPC_CODE_TABLE *table) {
+    if (const BPSCompressorDW *bpc = dynamic_cast<const BPSCompressorDW *>(comp)) {
+        if (bpc->trainable()) {
+            *table = bpc->trainCodeTable();
+            return true;
+        }
+    } else if (const BPSCompressor64 *bpc = dynamic_cast<const BPSCompressor64 *>(comp)) {
+        if (bpc->trainable()) {
+            *table = bpc->trainCodeTable();
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------
+#endif /* __COMPRESSOR_REGISTRY_HH__ */
@@ -29,6 +29,98 @@
 
 #include "common.hh"
 
+//------------------------------------------------------------------------------
+// FPC prefixes of a line in one vector pass (same result as the cascade in
+// FPCompressorDW::compressLine)
+//   count[p] : dwords taking prefix p; count[0] is the number of zero runs
+// Every pattern is tested on all dwords at once and a dword keeps the first
+// match in cascade order (priority mask). sign_extended() gets the dword
+// zero-extended, so prefixes 1/2/3/5 only take small non-negative values:
+// <= 7 / 127 / 32767, halfwords <= 127.
+// define FPC_NO_SIMD to always use the cascade
+#if (defined(__x86_64__) || defined(__i386__)) && ((LSIZE%256)==0) && !defined(FPC_NO_SIMD)
+#define FPC_SIMD
+#include <immintrin.h>
+#endif
+
+#define FPC_PREFIXES    8
+typedef void (*FPC_CLASSIFY_FUNC)(const CACHELINE_DATA *line, unsigned *count);
+
+// zero runs of a line (at most 8 dwords each) from its zero-dword mask:
+// one per run start, plus one per 8th, 16th and 24th dword into a run
+static inline unsigned fpc_zero_runs(UINT32 zero) {
+    UINT32 b2 = zero & (zero<<1);
+    UINT32 b4 = b2 & (b2<<2);
+    UINT32 b8 = b4 & (b4<<4);           // bit i: dwords i-7..i are zero
+    UINT32 a9 = b8 & (zero<<8);         // i-8..i
+    UINT32 a17 = a9 & (b8<<9);          // i-16..i
+    UINT32 a25 = a17 & (b8<<17);        // i-24..i
+    return __builtin_popcount(zero & ~(zero<<1)) + __builtin_popcount(a9 & ~(zero<<9))
+         + __builtin_popcount(a17 & ~(zero<<17)) + __builtin_popcount(a25 & ~(zero<<25));
+}
+
+#ifdef FPC_SIMD
+// popcnt: the default target calls libgcc for every count
+__attribute__((target("avx2,popcnt")))
+static void fpc_classify_avx2(const CACHELINE_DATA *line, unsigned *count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i byte0 = _mm256_setr_epi8(0,0,0,0, 4,4,4,4, 8,8,8,8, 12,12,12,12, 0,0,0,0, 4,4,4,4, 8,8,8,8, 12,12,12,12);
+    const __m256i halves = _mm256_set1_epi32(0xff80ff80);
+    __m256i v[_MAX_DWORDS_PER_LINE/8];
+    __m256i nonZero = zero;
+    for (int k=0; k<_MAX_DWORDS_PER_LINE/8; k++) {
+        v[k] = _mm256_loadu_si256((const __m256i *) &line->dword[k*8]);
+        nonZero = _mm256_or_si256(nonZero, v[k]);
+    }
+    if (_mm256_testz_si256(nonZero, nonZero)) {     // zero line: runs of 8
+        count[0] = _MAX_DWORDS_PER_LINE/8;
+        for (int p=1; p<FPC_PREFIXES; p++) {
+            count[p] = 0;
+        }
+        return;
+    }
+    UINT32 mask[FPC_PREFIXES] = {};
+    for (int k=0; k<_MAX_DWORDS_PER_LINE/8; k++) {
+        __m256i m[FPC_PREFIXES-1];
+        m[0] = _mm256_cmpeq_epi32(v[k], zero);
+        m[1] = _mm256_cmpeq_epi32(_mm256_srli_epi32(v[k], 3), zero);
+        m[2] = _mm256_cmpeq_epi32(_mm256_srli_epi32(v[k], 7), zero);
+        m[3] = _mm256_cmpeq_epi32(_mm256_srli_epi32(v[k], 15), zero);
+        m[4] = _mm256_cmpeq_epi32(_mm256_slli_epi32(v[k], 16), zero);
+        m[5] = _mm256_cmpeq_epi32(_mm256_and_si256(v[k], halves), zero);
+        m[6] = _mm256_cmpeq_epi32(_mm256_shuffle_epi8(v[k], byte0), v[k]);
+        for (int p=0; p<FPC_PREFIXES-1; p++) {
+            mask[p] |= ((UINT32) _mm256_movemask_ps(_mm256_castsi256_ps(m[p]))) << (k*8);
+        }
+    }
+    // first match in cascade order 0, 1, 2, 6, 3, 4, 5, 7
+    static const int order[FPC_PREFIXES-1] = { 0, 1, 2, 6, 3, 4, 5 };
+    UINT32 taken = 0;
+    for (int o=0; o<FPC_PREFIXES-1; o++) {
+        mask[order[o]] &= ~taken;
+        taken |= mask[order[o]];
+    }
+    mask[7] = ~taken & (UINT32) ((1ull<<_MAX_DWORDS_PER_LINE)-1);
+    count[0] = fpc_zero_runs(mask[0]);
+    for (int p=1; p<FPC_PREFIXES; p++) {
+        count[p] = __builtin_popcount(mask[p]);
+    }
+}
+#endif
+
+static FPC_CLASSIFY_FUNC fpc_select_classify() {
+#ifdef FPC_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return fpc_classify_avx2;
+    }
+#endif
+    return NULL;
+}
+
+// NULL if no vector kernel is usable -> FPCompressorDW keeps the cascade
+static FPC_CLASSIFY_FUNC fpc_classify = fpc_select_classify();
+
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -36,10 +128,15 @@ class FPCompressorDW: public Compressor {     // up to 256 patterns
 public:
     // constructor / destructor
     FPCompressorDW() : Compressor("FPC-DW") {}
+    Compressor *clone() const { return new FPCompressorDW(*this); }
+    COMPRESS_LINES(FPCompressorDW)
 
     // external interface
 public:
     LENGTH compressLine(CACHELINE_DATA *line, UINT64 line_addr) {
+        if (fpc_classify!=NULL) {
+            return compressMasks(line);
+        }
         unsigned zeroRun = 0;
         unsigned blkLength = 0;
 
@@ -93,6 +190,22 @@ public:
 
         countLineResult(blkLength);
 
+        return blkLength;
+    }
+
+protected:
+    // data bits + 3-bit prefix of each pattern; 0 is a zero run
+    LENGTH compressMasks(CACHELINE_DATA *line) {
+        static const unsigned bits[FPC_PREFIXES] = { 3+3, 4+3, 8+3, 16+3, 16+3, 16+3, 8+3, 32+3 };
+        unsigned count[FPC_PREFIXES];
+        fpc_classify(line, count);
+        unsigned blkLength = 0;
+        for (int p=0; p<FPC_PREFIXES; p++) {
+            countPatterns(p, count[p]);
+            blkLength += count[p]*bits[p];
+        }
+        countLineResult(blkLength);
+
         return blkLength;
     }
 };
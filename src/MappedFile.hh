@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __MAPPED_FILE_HH__
+#define __MAPPED_FILE_HH__
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "common.hh"
+
+//--------------------------------------------------------------------
+// Read-only mapping of a byte range of a snapshot file.
+// The range may start anywhere (it is widened down to an OS page boundary)
+// and may end in a partial OS page at the end of the file.
+// lines() is NULL if the range cannot be mapped (e.g. a pipe); callers
+// then fall back to fread.
+class MappedFile {
+    public:
+        MappedFile(const char *name, off_t offset, size_t length, bool populate)
+        : base(NULL), map_length(0), data(NULL) {
+            if (length==0) {
+                return;
+            }
+            int fd = open(name, O_RDONLY);
+            if (fd<0) {
+                return;
+            }
+            off_t page = sysconf(_SC_PAGESIZE);
+            off_t map_offset = offset - (offset % page);
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            if (populate) {
+                flags |= MAP_POPULATE;
+            }
+#endif
+            map_length = length + (size_t) (offset - map_offset);
+            void *p = mmap(NULL, map_length, PROT_READ, flags, fd, map_offset);
+            close(fd);
+            if (p==MAP_FAILED) {
+                return;
+            }
+            base = p;
+            madvise(base, map_length, MADV_SEQUENTIAL);
+            data = (CACHELINE_DATA *) ((char *) base + (offset - map_offset));
+        }
+        ~MappedFile() {
+            if (base!=NULL) {
+                munmap(base, map_length);
+            }
+        }
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+    public:
+        // compressors take non-const lines but never write them
+        CACHELINE_DATA *lines() const { return data; }
+    protected:
+        void *base;
+        size_t map_length;
+        CACHELINE_DATA *data;
+};
+
+//--------------------------------------------------------------------
+#endif /* __MAPPED_FILE_HH__ */
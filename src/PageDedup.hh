@@ -0,0 +1,213 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __PAGE_DEDUP_HH__
+#define __PAGE_DEDUP_HH__
+
+#include "common.hh"
+#include "PagePacker.hh"
+
+// define PAGE_NO_SIMD to always use the scalar zero check
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(PAGE_NO_SIMD)
+#define PAGE_SIMD
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------------------
+// All-zero page check
+// : most non-zero pages are rejected within the first 256 bytes
+typedef bool (*PAGE_ZERO_FUNC)(const UINT8 *page);
+
+static bool page_is_zero_scalar(const UINT8 *page) {
+    const UINT64 *q = (const UINT64 *) page;
+    for (int i=0; i<PAGE_SIZE/8; i+=32) {
+        UINT64 acc = 0;
+        for (int j=0; j<32; j++) {
+            acc |= q[i+j];
+        }
+        if (acc!=0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef PAGE_SIMD
+__attribute__((target("avx2")))
+static bool page_is_zero_avx2(const UINT8 *page) {
+    for (int i=0; i<PAGE_SIZE; i+=256) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *) &page[i]);
+        for (int j=32; j<256; j+=32) {
+            acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i *) &page[i+j]));
+        }
+        if (!_mm256_testz_si256(acc, acc)) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+static PAGE_ZERO_FUNC page_select_is_zero() {
+#ifdef PAGE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return page_is_zero_avx2;
+    }
+#endif
+    return page_is_zero_scalar;
+}
+
+static PAGE_ZERO_FUNC page_is_zero = page_select_is_zero();
+
+//--------------------------------------------------------------------
+// 128-bit content hash of a page: four xxHash64-style lanes folded twice
+// : pages with equal hashes are compared before one is taken as a duplicate
+static inline UINT64 page_hash_round(UINT64 acc, UINT64 input) {
+    acc += input * 0xC2B2AE3D27D4EB4Full;
+    acc = (acc << 31) | (acc >> 33);
+    return acc * 0x9E3779B185EBCA87ull;
+}
+
+static void page_hash(const UINT8 *page, UINT64 *h1, UINT64 *h2) {
+    const UINT64 *q = (const UINT64 *) page;
+    UINT64 lane[4] = { 0x60EA27EEADC0B5D6ull, 0xC2B2AE3D27D4EB4Full, 0x0ull, 0x61C8864E7A143579ull };
+    for (int i=0; i<PAGE_SIZE/8; i+=4) {
+        for (int k=0; k<4; k++) {
+            lane[k] = page_hash_round(lane[k], q[i+k]);
+        }
+    }
+    UINT64 a = 0ull, b = 0ull;
+    for (int k=0; k<4; k++) {
+        a = page_hash_round(a, lane[k]);
+        b = page_hash_round(b ^ 0x165667B19E3779F9ull, lane[3-k]);
+    }
+    *h1 = a ^ (a >> 29);
+    *h2 = b ^ (b >> 32);
+}
+
+//--------------------------------------------------------------------
+// Zero / duplicate page filter
+// : a duplicate is a non-zero page with the content of a page before it
+//   (same hash, then memcmp against the copy kept of that page); the first
+//   page with a content is the one compressed
+// : classify() must see the pages in page order. Parallel workers reach
+//   them out of order, so a serial pass classifies them first (record(),
+//   then replay()) and the workers read the results back; the counts and
+//   the pages compressed are then those of the serial run
+enum { PAGE_UNIQUE, PAGE_ZERO, PAGE_DUPLICATE };
+
+#define DEDUP_CHUNK_PAGES 256       // pages per block of kept copies
+
+class PageDedup {
+    public:
+        PageDedup() : recording(false), replaying(false), kept(0ull) {}
+        // page: its page number; *copy gets the page holding the content of
+        // a duplicate
+        int classify(const CACHELINE_DATA *page, CNT page_no, CNT *copy) {
+            if (replaying) {
+                if ((page_no<results.size()) && (results[page_no].kind>=0)) {
+                    *copy = results[page_no].copy;
+                    return results[page_no].kind;
+                }
+                // not reached by the serial pass (cut by an input's end)
+                return page_is_zero((const UINT8 *) page) ? PAGE_ZERO : PAGE_UNIQUE;
+            }
+            int kind = check((const UINT8 *) page, page_no, copy);
+            if (recording) {
+                if (results.size()<=page_no) {
+                    PAGE_RESULT none = { -1, NO_COPY };
+                    results.resize(page_no+1, none);
+                }
+                results[page_no].kind = kind;
+                results[page_no].copy = (kind==PAGE_DUPLICATE) ? *copy : NO_COPY;
+            }
+            return kind;
+        }
+        // keeps the result of every page classified from now on
+        void record() { recording = true; }
+        // classify() returns the recorded results; the kept copies are freed
+        void replay() {
+            recording = false;
+            replaying = true;
+            seen.clear();
+            vector<vector<UINT8> >().swap(store);
+            kept = 0ull;
+        }
+    protected:
+        int check(const UINT8 *bytes, CNT page_no, CNT *copy) {
+            if (page_is_zero(bytes)) {
+                return PAGE_ZERO;
+            }
+            UINT64 h1, h2;
+            page_hash(bytes, &h1, &h2);
+            lock_guard<mutex> lock(m);
+            auto it = seen.find(h1);
+            if (it==seen.end()) {
+                PAGE_SEEN first = { h2, page_no, keep(bytes) };
+                seen.insert(pair<UINT64, PAGE_SEEN>(h1, first));
+                return PAGE_UNIQUE;
+            }
+            // a collision (h1 alone, or both hashes): unique, no entry
+            if ((it->second.h2!=h2) || (memcmp(kept_page(it->second.slot), bytes, PAGE_SIZE)!=0)) {
+                return PAGE_UNIQUE;
+            }
+            *copy = it->second.page;
+            return PAGE_DUPLICATE;
+        }
+        // copy of a first page
+        CNT keep(const UINT8 *bytes) {
+            if (kept%DEDUP_CHUNK_PAGES==0) {
+                store.push_back(vector<UINT8>(DEDUP_CHUNK_PAGES*PAGE_SIZE));
+            }
+            memcpy(&store.back()[(kept%DEDUP_CHUNK_PAGES)*PAGE_SIZE], bytes, PAGE_SIZE);
+            return kept++;
+        }
+        const UINT8 *kept_page(CNT slot) const {
+            return &store[slot/DEDUP_CHUNK_PAGES][(slot%DEDUP_CHUNK_PAGES)*PAGE_SIZE];
+        }
+
+        typedef struct {
+            UINT64 h2;
+            CNT page;           // first page with the content
+            CNT slot;           // of its copy
+        } PAGE_SEEN;
+        typedef struct {
+            int kind;           // -1 if not classified
+            CNT copy;
+        } PAGE_RESULT;
+
+        unordered_map<UINT64, PAGE_SEEN> seen;      // h1 -> first page
+        vector<vector<UINT8> > store;               // copies of the first pages
+        vector<PAGE_RESULT> results;                // per page, record() / replay()
+        bool recording, replaying;
+        CNT kept;
+        mutex m;
+};
+
+//--------------------------------------------------------------------
+#endif /* __PAGE_DEDUP_HH__ */
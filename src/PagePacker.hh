@@ -0,0 +1,288 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __PAGE_PACKER_HH__
+#define __PAGE_PACKER_HH__
+
+#include "common.hh"
+
+#define PAGE_SIZE 4096
+#define LINE_PER_PAGE ((PAGE_SIZE*8)/LSIZE)
+// block size classes in common.hh are for 64B lines
+#define BLOCK_SIZE(frag, i) (block_sizes[frag][i]*LSIZE/512)
+
+// rounds the compressed lines of a page to block / page size classes
+int packPage(unsigned *size, int block_frag, int page_frag) {
+    int min_page=PAGE_SIZE*8; //Uncompressed page size
+    int totallen=0;
+    for(int lineid=0; lineid<LINE_PER_PAGE; lineid++) {
+        for (unsigned i=0; i<8; i++) {
+            if(size[lineid] <= BLOCK_SIZE(block_frag, i)) {
+                totallen+=BLOCK_SIZE(block_frag, i);
+                size[lineid] = BLOCK_SIZE(block_frag, i);
+                break;
+            }
+            if(i== 7){
+                totallen+=BLOCK_SIZE(block_frag, i);
+                size[lineid] = BLOCK_SIZE(block_frag, i);
+            }
+        }
+        //cout << " " <<size[lineid];
+    }
+    if(totallen<min_page)
+        min_page=totallen;
+    if(min_page!=0){
+        //THIS STEP IS FOR PAGE PACKING
+        int page_pack=1;
+        if (page_pack){
+            for(int i=0; i<8; i++) {
+                if(min_page <= page_sizes[page_frag][i]){
+                    min_page = page_sizes[page_frag][i];
+                    break;
+                }
+            }
+        }
+    }
+    return min_page;
+}
+
+// a page in the compressed store
+typedef struct {
+    unsigned bits;          // packed size (page size class), 0 for a zero page
+    unsigned compressed;    // lines stored compressed (to decompress on a read)
+    CNT copy;               // page holding the data of a duplicate, NO_COPY otherwise
+} PACKED_PAGE;
+
+#define NO_COPY (~0ull)
+
+//--------------------------------------------------------------------
+// Layout of a compressed page and its line-offset metadata
+// Lines are stored back to back in line order, each one rounded to its
+// block size class. Two ways to find line i in the page:
+//   size codes : a block class code per line; the offset of line i is the
+//                sum of the sizes of lines 0..i-1 (i adds)
+//   end offsets: the end of every line (in granules); line i spans
+//                [end[i-1], end[i]) (no adds)
+// With layoutPages(), both tables are built for every packed page, as bit
+// strings of LINE_PER_PAGE fixed-width entries, and every line is located
+// through each of them. The metadata is stored in the page, so
+// it can push a page into the next page size class; an all-zero page needs
+// neither lines nor metadata.
+class PagePacker {
+    public:
+        PagePacker(int _block_frag, int _page_frag)
+        : block_frag(_block_frag), page_frag(_page_frag), classes(0), granule(0), codeTableBits(0), endTableBits(0),
+          codePages(0ull), endPages(0ull), lookups(0ull), codeAdds(0ull), codeReadBits(0ull), endReadBits(0ull), keep(false), lay_out(false) {
+            for (int i=0; i<8; i++) {
+                unsigned block = BLOCK_SIZE(block_frag, i);
+                if ((classes==0) || (classSize[classes-1]!=block)) {
+                    classSize[classes++] = block;
+                }
+                if (block>0) {
+                    unsigned a = granule, b = block;    // gcd of the block sizes
+                    while (b>0) {
+                        unsigned t = a%b;
+                        a = b;
+                        b = t;
+                    }
+                    granule = a;
+                }
+            }
+            codeBits = bitsFor(classes-1);
+            endBits = bitsFor((PAGE_SIZE*8)/granule);
+            offset[0] = 0;
+        }
+    public:
+        // packPage() that also lays the page out and builds its metadata
+        // (layoutPages())
+        // : size[] is rounded in place; returns the page size without metadata
+        int pack(unsigned *size) {
+            int page = packPage(size, block_frag, page_frag);
+            if (lay_out) {
+                layout(size);
+            }
+            if (lay_out && (page>0)) {
+                codePages += withMetadata(offset[LINE_PER_PAGE], codeTableBits);
+                endPages += withMetadata(offset[LINE_PER_PAGE], endTableBits);
+                for (int l=0; l<LINE_PER_PAGE; l++) {
+                    unsigned adds, bits;
+                    unsigned at = offsetByCodes(l, &adds, &bits);
+                    assert(at==offset[l]);
+                    codeAdds += adds;
+                    codeReadBits += bits;
+                    at = offsetByEnds(l, &bits);
+                    assert(at==offset[l]);
+                    endReadBits += bits;
+                }
+                lookups += LINE_PER_PAGE;
+            }
+            if (keep) {
+                PACKED_PAGE packed = { (unsigned) page, 0, NO_COPY };
+                for (int l=0; (l<LINE_PER_PAGE) && (page<PAGE_SIZE*8); l++) {
+                    packed.compressed += (size[l]>0) && (size[l]<LSIZE);
+                }
+                pages.push_back(packed);
+            }
+            return page;
+        }
+        // lays out lines of block class sizes back to back and builds both
+        // metadata tables of the page
+        void layout(const unsigned *size) {
+            memset(codeTable, 0, sizeof(codeTable));
+            memset(endTable, 0, sizeof(endTable));
+            codeTableBits = 0;
+            endTableBits = 0;
+            for (int l=0; l<LINE_PER_PAGE; l++) {
+                unsigned code = 0;
+                while (classSize[code]!=size[l]) {
+                    code++;
+                    assert(code<classes);
+                }
+                offset[l+1] = offset[l] + size[l];
+                codeTableBits = putBits(codeTable, codeTableBits, codeBits, code);
+                endTableBits = putBits(endTable, endTableBits, endBits, offset[l+1]/granule);
+            }
+        }
+        // bit offset of a line of the last laid out page, where the layout put it
+        unsigned lineOffset(int line) const { return offset[line]; }
+        // ... and as found from each table, with the adds and the metadata
+        // bits read to locate and size the line
+        unsigned offsetByCodes(int line, unsigned *adds, unsigned *bits) const {
+            unsigned at = 0;
+            for (int l=0; l<line; l++) {
+                at += classSize[getBits(codeTable, l*codeBits, codeBits)];
+            }
+            *adds = line;
+            *bits = (line+1)*codeBits;      // codes 0..line
+            return at;
+        }
+        unsigned offsetByEnds(int line, unsigned *bits) const {
+            if (line==0) {
+                *bits = endBits;            // end[0]
+                return 0;
+            }
+            *bits = 2*endBits;              // end[line-1], end[line]
+            return getBits(endTable, (line-1)*endBits, endBits)*granule;
+        }
+    public:
+        // metadata per page (in bits), as built
+        unsigned codeMetadataBits() const { return codeTableBits; }
+        unsigned endMetadataBits() const { return endTableBits; }
+        // measured per line located
+        double codeLookupAdds() const { return (lookups>0) ? (double) codeAdds/lookups : 0.0; }
+        double codeLookupBits() const { return (lookups>0) ? (double) codeReadBits/lookups : 0.0; }
+        double endLookupBits() const { return (lookups>0) ? (double) endReadBits/lookups : 0.0; }
+        // packed sizes (in bits) with the metadata in the page (layoutPages())
+        CNT getCodePages() const { return codePages; }
+        CNT getEndPages() const { return endPages; }
+        // a zero page or a duplicate of page copy, which is not packed
+        void skip(CNT copy) {
+            if (keep) {
+                PACKED_PAGE packed = { 0, 0, copy };
+                pages.push_back(packed);
+            }
+        }
+        // keeps every packed page, in order (for TierSimulator)
+        void keepPages() { keep = true; }
+        const vector<PACKED_PAGE> &getPages() const { return pages; }
+        // lays out every packed page and locates each of its lines through
+        // both tables (vsc -m)
+        void layoutPages() { lay_out = true; }
+        // adds the statistics of a packer with the same configuration that
+        // packed the pages following ours
+        void merge(const PagePacker &other) {
+            codeTableBits = max(codeTableBits, other.codeTableBits);
+            endTableBits = max(endTableBits, other.endTableBits);
+            codePages += other.codePages;
+            endPages += other.endPages;
+            lookups += other.lookups;
+            codeAdds += other.codeAdds;
+            codeReadBits += other.codeReadBits;
+            endReadBits += other.endReadBits;
+            pages.insert(pages.end(), other.pages.begin(), other.pages.end());
+        }
+    protected:
+        static unsigned bitsFor(unsigned max_value) {
+            unsigned bits = 0;
+            while ((1u<<bits) <= max_value) {
+                bits++;
+            }
+            return bits;
+        }
+        // a field of a table (LSB first); putBits returns the position after it
+        static unsigned putBits(UINT8 *table, unsigned pos, unsigned bits, unsigned value) {
+            for (unsigned b=0; b<bits; b++, pos++) {
+                table[pos/8] |= ((value>>b)&1) << (pos%8);
+            }
+            return pos;
+        }
+        static unsigned getBits(const UINT8 *table, unsigned pos, unsigned bits) {
+            unsigned value = 0;
+            for (unsigned b=0; b<bits; b++, pos++) {
+                value |= ((table[pos/8]>>(pos%8))&1u) << b;
+            }
+            return value;
+        }
+        // page size class of the lines plus metadata; pages that do not fit
+        // are kept uncompressed without metadata
+        int withMetadata(unsigned lines, unsigned metadata) const {
+            unsigned bits = lines + metadata;
+            for (int i=0; i<8; i++) {
+                if (bits <= (unsigned) page_sizes[page_frag][i]) {
+                    return page_sizes[page_frag][i];
+                }
+            }
+            return PAGE_SIZE*8;
+        }
+    protected:
+        int block_frag;
+        int page_frag;
+        unsigned classSize[8];      // distinct block sizes (in bits)
+        unsigned classes;
+        unsigned granule;           // gcd of the block sizes (in bits)
+        unsigned codeBits;          // per table entry
+        unsigned endBits;
+        // last laid out page
+        unsigned offset[LINE_PER_PAGE+1];
+        UINT8 codeTable[LINE_PER_PAGE];         // codes of up to 8 bits
+        UINT8 endTable[LINE_PER_PAGE*4];        // ends of up to 32 bits
+        unsigned codeTableBits;
+        unsigned endTableBits;
+        // statistics
+        CNT codePages;
+        CNT endPages;
+        CNT lookups;
+        CNT codeAdds;
+        CNT codeReadBits;
+        CNT endReadBits;
+        bool keep;
+        bool lay_out;
+        vector<PACKED_PAGE> pages;
+};
+
+//--------------------------------------------------------------------
+#endif /* __PAGE_PACKER_HH__ */
@@ -0,0 +1,180 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __PAGE_SAMPLER_HH__
+#define __PAGE_SAMPLER_HH__
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "common.hh"
+#include "PagePacker.hh"
+
+//--------------------------------------------------------------------
+// Sampled runs (vsc -s percent[:seed])
+// : the pages of each input are cut into strata of 1/rate pages, and one
+//   page at a random offset of every stratum is compressed (a stratum cut
+//   short by the end of the input is sampled when the offset falls in it),
+//   so every page is picked with probability rate
+// : an input is topped up with pages picked at random to at least two
+//   sampled pages (one when it has a single page), so that every input has
+//   a mean and a variance in the estimate
+// : the estimate is stratified by input: an input's packed size is its page
+//   count times the mean of its sampled pages, with the variance of that
+//   mean (finite population corrected) for the confidence interval
+
+// reproducible stream of random numbers (splitmix64)
+static UINT64 sample_next(UINT64 &state) {
+    UINT64 z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z>>30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z>>27)) * 0x94d049bb133111ebull;
+    return z ^ (z>>31);
+}
+
+// pages of [0, pages) to compress, in increasing order
+static void samplePages(CNT pages, double rate, UINT64 seed, vector<CNT> &sample) {
+    CNT stratum = max(1ull, (CNT) (1.0/rate + 0.5));
+    UINT64 state = seed;
+    for (CNT first=0; first<pages; first+=stratum) {
+        CNT page = first + sample_next(state) % stratum;
+        if (page<pages) {
+            sample.push_back(page);
+        }
+    }
+    while (sample.size()<min(pages, 2ull)) {
+        CNT page = sample_next(state) % pages;
+        auto it = lower_bound(sample.begin(), sample.end(), page);
+        if ((it==sample.end()) || (*it!=page)) {
+            sample.insert(it, page);
+        }
+    }
+}
+
+// reads one page at a byte offset of an input, without read-ahead of the
+// pages around it
+class PageReader {
+    public:
+        PageReader(const char *name) {
+            fd = open(name, O_RDONLY);
+#ifdef POSIX_FADV_RANDOM
+            if (fd>=0) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+            }
+#endif
+        }
+        ~PageReader() {
+            if (fd>=0) {
+                close(fd);
+            }
+        }
+    private:
+        PageReader(const PageReader &);
+        PageReader &operator=(const PageReader &);
+    public:
+        bool ok() const { return fd>=0; }
+        bool read(off_t offset, void *page) {
+            size_t got = 0;
+            while (got<PAGE_SIZE) {
+                ssize_t n = pread(fd, (char *) page+got, PAGE_SIZE-got, offset+got);
+                if (n<=0) {
+                    return false;
+                }
+                got += n;
+            }
+            return true;
+        }
+    protected:
+        int fd;
+};
+
+// packed page sizes sampled from one input for one compressor
+typedef struct {
+    CNT pages;              // pages in the input
+    CNT n;                  // pages sampled
+    double sum, sum_sq;     // of their packed sizes (bits)
+} SAMPLE_STRATUM;
+
+class SampleEstimate {
+    public:
+        SampleEstimate() {}
+        void addInput(CNT pages) {
+            SAMPLE_STRATUM s = { pages, 0ull, 0.0, 0.0 };
+            strata.push_back(s);
+        }
+        // a sampled page of the last input
+        void addPage(unsigned bits) {
+            SAMPLE_STRATUM &s = strata.back();
+            s.n++;
+            s.sum += bits;
+            s.sum_sq += (double) bits*bits;
+            classes[bits]++;
+        }
+        // each sampled page of an input stands for pages/n of its pages
+        void closeInput() {
+            const SAMPLE_STRATUM &s = strata.back();
+            assert((s.n>0) || (s.pages==0));
+            for (auto it = classes.cbegin(); it != classes.cend(); ++it) {
+                weighted[it->first] += (double) it->second*s.pages/s.n;
+            }
+            classes.clear();
+        }
+
+        CNT getSampled() const {
+            CNT n = 0ull;
+            for (auto it = strata.cbegin(); it != strata.cend(); ++it) {
+                n += it->n;
+            }
+            return n;
+        }
+        // estimated packed size of all pages (bits) and its variance
+        // : every input with pages has sampled ones (samplePages)
+        double getTotal(double *variance) const {
+            double total = 0.0;
+            *variance = 0.0;
+            for (auto it = strata.cbegin(); it != strata.cend(); ++it) {
+                if (it->n==0) {
+                    continue;
+                }
+                double mean = it->sum/it->n;
+                total += mean*it->pages;
+                if (it->n>1) {
+                    double var = (it->sum_sq - it->n*mean*mean)/(it->n-1);
+                    double fpc = 1.0 - (double) it->n/it->pages;
+                    *variance += (double) it->pages*it->pages*max(var, 0.0)/it->n*fpc;
+                }
+            }
+            return total;
+        }
+        // estimated pages per packed size (bits)
+        const map<unsigned, double> &getClasses() const { return weighted; }
+    protected:
+        vector<SAMPLE_STRATUM> strata;
+        map<unsigned, CNT> classes;         // sampled pages of the last input
+        map<unsigned, double> weighted;     // estimated pages of all inputs
+};
+
+//--------------------------------------------------------------------
+#endif /* __PAGE_SAMPLER_HH__ */
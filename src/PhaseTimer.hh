@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __PHASE_TIMER_HH__
+#define __PHASE_TIMER_HH__
+
+//--------------------------------------------------------------------
+// Per-phase timing of compressLine, compiled in with -DPHASE_TIMING
+//   PHASE_BEGIN(t); ...; PHASE_END(PHASE_X, t); ...; PHASE_END(PHASE_Y, t);
+// charges the clock ticks of each step to its phase in the compressor's
+// counters (Compressor::phases). Without PHASE_TIMING the macros expand to
+// nothing and Compressor has no counters, so the cost is zero.
+enum { PHASE_TRANSFORM, PHASE_BITPLANE, PHASE_ENCODE, PHASE_FRAG, PHASES };
+
+#ifdef PHASE_TIMING
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PHASE_UNIT "cycles"
+static inline UINT64 phase_clock() { return __rdtsc(); }
+#else
+#include <time.h>
+#define PHASE_UNIT "ns"
+static inline UINT64 phase_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+#endif
+
+static const char *const PHASE_NAMES[PHASES] = { "transform", "bit-plane", "encode", "frag" };
+
+typedef struct {
+    CNT ticks[PHASES];
+    CNT calls[PHASES];
+} PHASE_COUNTERS;
+
+#define PHASE_BEGIN(t)      UINT64 t = phase_clock()
+#define PHASE_END(phase, t) \
+    do { \
+        UINT64 now_ = phase_clock(); \
+        phases.ticks[phase] += now_ - (t); \
+        phases.calls[phase]++; \
+        t = now_; \
+    } while (0)
+#else
+#define PHASE_BEGIN(t)
+#define PHASE_END(phase, t)
+#endif
+
+//--------------------------------------------------------------------
+#endif /* __PHASE_TIMER_HH__ */
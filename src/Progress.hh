@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __PROGRESS_HH__
+#define __PROGRESS_HH__
+
+#include "common.hh"
+#include "PagePacker.hh"
+
+//--------------------------------------------------------------------
+// Progress of one worker: written by that worker only (once per page),
+// read by the progress thread; padded so no two workers write one cache line
+typedef struct {
+    atomic<CNT> pages;      // pages done
+    atomic<CNT> bits;       // packed size of the first compressor so far
+    char pad[64-2*sizeof(atomic<CNT>)];
+} PROGRESS_SHARD;
+
+// prints a progress line to stderr once per second until destroyed
+// : total_pages is 0 when unknown (streamed inputs)
+class ProgressMonitor {
+    public:
+        ProgressMonitor(const PROGRESS_SHARD *_shards, int _count, CNT _total_pages)
+        : shards(_shards), count(_count), total_pages(_total_pages), done(false) {
+            start = chrono::steady_clock::now();
+            monitor = thread(&ProgressMonitor::loop, this);
+        }
+        ~ProgressMonitor() {
+            {
+                lock_guard<mutex> lock(m);
+                done = true;
+            }
+            cv.notify_all();
+            monitor.join();
+        }
+    private:
+        ProgressMonitor(const ProgressMonitor &);
+        ProgressMonitor &operator=(const ProgressMonitor &);
+    protected:
+        void loop() {
+            unique_lock<mutex> lock(m);
+            while (!cv.wait_for(lock, chrono::seconds(1), [this]() { return done; })) {
+                report();
+            }
+        }
+        void report() const {
+            CNT pages = 0ull, bits = 0ull;
+            for (int i=0; i<count; i++) {
+                pages += shards[i].pages.load(memory_order_relaxed);
+                bits += shards[i].bits.load(memory_order_relaxed);
+            }
+            double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            double bytes = (double) pages*PAGE_SIZE;
+            fprintf(stderr, "progress: %lld", pages);
+            if (total_pages>0) {
+                fprintf(stderr, "/%lld pages (%.1f%%)", total_pages, pages*100./total_pages);
+            } else {
+                fprintf(stderr, " pages");
+            }
+            fprintf(stderr, " %.2f GB/s", bytes/secs/1e9);
+            if (bits>0) {
+                fprintf(stderr, " ratio %.2f", bytes*8/bits);
+            }
+            if ((total_pages>0) && (pages>0)) {
+                fprintf(stderr, " ETA %.0f s", (total_pages-pages)*secs/pages);
+            }
+            fprintf(stderr, "\n");
+        }
+    protected:
+        const PROGRESS_SHARD *shards;
+        int count;
+        CNT total_pages;
+        bool done;
+        chrono::steady_clock::time_point start;
+        thread monitor;
+        mutex m;
+        condition_variable cv;
+};
+
+//--------------------------------------------------------------------
+#endif /* __PROGRESS_HH__ */
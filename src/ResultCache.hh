@@ -0,0 +1,304 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __RESULT_CACHE_HH__
+#define __RESULT_CACHE_HH__
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common.hh"
+#include "PagePacker.hh"
+#include "PageDedup.hh"
+
+//--------------------------------------------------------------------
+// On-disk cache of compressed line sizes (vsc -C file)
+// : key = 128-bit hash of a page and the line before it (the compressors'
+//   state) mixed with a hash of the compressor configuration; value = the
+//   LINE_PER_PAGE line lengths compressLines() gave
+// : the file is one open-addressing table (header + slots), memory-mapped
+//   shared, so lookups touch only the slots probed and new entries reach
+//   the file through the page cache
+// : entries hold for CACHE_VERSION of the compressors; a file of another
+//   version or line size is started over
+// : the file is locked (flock) for the run; runs sharing a file wait. A run
+//   that grows the table renames a new file over it, so a run that was
+//   waiting reopens the file if the one it locked was replaced
+// : the table is sized at open for the pages of the run, and doubled by
+//   insert() above CACHE_MAX_LOAD, so streamed inputs of unknown size fit
+#define CACHE_MAGIC         "VSCCACHE"
+#define CACHE_VERSION       1       // bump when a compressor's line sizes change
+#define CACHE_MIN_SLOTS     (1ull<<16)
+#define CACHE_MAX_LOAD      0.7     // grown above this
+#define CACHE_FULL_LOAD     0.9     // no more inserts above this, if it cannot grow
+
+typedef struct {
+    char magic[8];
+    UINT64 version;         // CACHE_VERSION
+    UINT32 lines;           // LINE_PER_PAGE
+    UINT32 line_bits;       // LSIZE
+    UINT64 slots;           // power of 2
+    UINT64 count;
+} CACHE_HEADER;
+
+typedef struct {
+    UINT64 k1, k2;          // (0, 0) for an empty slot
+    UINT16 size[LINE_PER_PAGE];
+} CACHE_SLOT;
+
+// FNV-1a
+static UINT64 cache_hash(const void *data, size_t bytes, UINT64 h = 0xcbf29ce484222325ull) {
+    const UINT8 *p = (const UINT8 *) data;
+    for (size_t i=0; i<bytes; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// content key of a page: the page and the line before it
+typedef struct {
+    UINT64 h1, h2;
+} PAGE_KEY;
+
+class ResultCache {
+    public:
+        ResultCache() : fd(-1), base(NULL), bytes(0), header(NULL), slots(NULL), full(false) {}
+        ~ResultCache() {
+            unmap();
+            if (fd>=0) {
+                close(fd);      // drops the lock
+            }
+        }
+    private:
+        ResultCache(const ResultCache &);
+        ResultCache &operator=(const ResultCache &);
+    public:
+        // opens (or creates) the cache, with room for new_entries more
+        bool open(const char *name, CNT new_entries) {
+            path = name;
+            struct stat st;
+            for (;;) {
+                fd = ::open(name, O_RDWR|O_CREAT, 0644);
+                if ((fd<0) || (flock(fd, LOCK_EX)!=0) || (fstat(fd, &st)!=0)) {
+                    return false;
+                }
+                // the file locked is still the one at name (not grown away)
+                struct stat at_name;
+                if ((stat(name, &at_name)==0) && (at_name.st_dev==st.st_dev) && (at_name.st_ino==st.st_ino)) {
+                    break;
+                }
+                close(fd);
+            }
+            CACHE_HEADER h;
+            bool valid = ((size_t) st.st_size >= sizeof(h)) && (pread(fd, &h, sizeof(h), 0)==(ssize_t) sizeof(h))
+                && (memcmp(h.magic, CACHE_MAGIC, 8)==0) && (h.version==CACHE_VERSION) && (h.lines==LINE_PER_PAGE) && (h.line_bits==LSIZE)
+                && ((UINT64) st.st_size == sizeof(h) + h.slots*sizeof(CACHE_SLOT));
+            if (!valid) {
+                if (st.st_size>0) {
+                    fprintf(stderr, "%s: written by another version or line size, starting over\n", name);
+                }
+                return create(fd, slotsFor(new_entries)) && map();
+            }
+            if (!map()) {
+                return false;
+            }
+            if (header->count + new_entries > header->slots*CACHE_MAX_LOAD) {
+                return grow(slotsFor(header->count + new_entries));
+            }
+            return true;
+        }
+        CNT getCount() const { return header->count; }
+
+        static PAGE_KEY pageKey(const CACHELINE_DATA *page, const CACHELINE_DATA *prev_line) {
+            PAGE_KEY key;
+            page_hash((const UINT8 *) page, &key.h1, &key.h2);
+            for (int i=0; i<_MAX_QWORDS_PER_LINE; i++) {
+                key.h1 = page_hash_round(key.h1, prev_line->qword[i]);
+                key.h2 = page_hash_round(key.h2 ^ 0x165667B19E3779F9ull, prev_line->qword[i]);
+            }
+            return key;
+        }
+        // false on a miss
+        bool lookup(const PAGE_KEY &page, UINT64 config, LENGTH *size) {
+            UINT64 k1, k2;
+            slotKey(page, config, &k1, &k2);
+            lock_guard<mutex> lock(m);
+            CACHE_SLOT *slot = probe(slots, header->slots, k1, k2);
+            if (slot->k1!=k1 || slot->k2!=k2) {
+                return false;
+            }
+            for (int i=0; i<LINE_PER_PAGE; i++) {
+                size[i] = slot->size[i];
+            }
+            return true;
+        }
+        void insert(const PAGE_KEY &page, UINT64 config, const LENGTH *size) {
+            UINT64 k1, k2;
+            slotKey(page, config, &k1, &k2);
+            lock_guard<mutex> lock(m);
+            CACHE_SLOT *slot = probe(slots, header->slots, k1, k2);
+            if (slot->k1==k1 && slot->k2==k2) {
+                return;
+            }
+            if (!full && (header->count+1 > header->slots*CACHE_MAX_LOAD)) {
+                if (grow(header->slots<<1)) {
+                    slot = probe(slots, header->slots, k1, k2);
+                } else {
+                    fprintf(stderr, "%s: cannot grow, entries up to %.0f%% load this run\n", path.c_str(), CACHE_FULL_LOAD*100);
+                    full = true;
+                }
+            }
+            if (header->count+1 > header->slots*CACHE_FULL_LOAD) {
+                return;
+            }
+            for (int i=0; i<LINE_PER_PAGE; i++) {
+                slot->size[i] = size[i];
+            }
+            slot->k2 = k2;
+            slot->k1 = k1;
+            header->count++;
+        }
+
+    protected:
+        static UINT64 slotsFor(CNT entries) {
+            UINT64 n = CACHE_MIN_SLOTS;
+            while (entries > n*CACHE_MAX_LOAD) {
+                n <<= 1;
+            }
+            return n;
+        }
+        static void slotKey(const PAGE_KEY &page, UINT64 config, UINT64 *k1, UINT64 *k2) {
+            *k1 = page.h1 ^ config;
+            *k2 = page.h2 ^ page_hash_round(0ull, config);
+            if ((*k1==0) && (*k2==0)) {
+                *k2 = 1;
+            }
+        }
+        // the slot holding (k1, k2), or the empty slot it would go to
+        static CACHE_SLOT *probe(CACHE_SLOT *table, UINT64 n, UINT64 k1, UINT64 k2) {
+            for (UINT64 i = k1 & (n-1); ; i = (i+1) & (n-1)) {
+                CACHE_SLOT *slot = &table[i];
+                if ((slot->k1==k1 && slot->k2==k2) || (slot->k1==0 && slot->k2==0)) {
+                    return slot;
+                }
+            }
+        }
+        // an empty table of n slots in file f
+        bool create(int f, UINT64 n) {
+            CACHE_HEADER h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, CACHE_MAGIC, 8);
+            h.version = CACHE_VERSION;
+            h.lines = LINE_PER_PAGE;
+            h.line_bits = LSIZE;
+            h.slots = n;
+            h.count = 0;
+            // ftruncate zero-fills: every slot is empty
+            return (ftruncate(f, 0)==0) && (ftruncate(f, sizeof(h) + n*sizeof(CACHE_SLOT))==0)
+                && (pwrite(f, &h, sizeof(h), 0)==(ssize_t) sizeof(h));
+        }
+        bool map() {
+            struct stat st;
+            if (fstat(fd, &st)!=0) {
+                return false;
+            }
+            bytes = st.st_size;
+            base = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base==MAP_FAILED) {
+                base = NULL;
+                return false;
+            }
+            madvise(base, bytes, MADV_RANDOM);
+            header = (CACHE_HEADER *) base;
+            slots = (CACHE_SLOT *) ((char *) base + sizeof(CACHE_HEADER));
+            return true;
+        }
+        void unmap() {
+            if (base!=NULL) {
+                munmap(base, bytes);
+                base = NULL;
+            }
+        }
+        // rehashes into a new file of n slots that replaces the old one
+        // : on failure the old table stays mapped
+        bool grow(UINT64 n) {
+            string tmp = path + ".tmp";
+            int f = ::open(tmp.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+            if (f<0) {
+                return false;
+            }
+            size_t new_bytes = sizeof(CACHE_HEADER) + n*sizeof(CACHE_SLOT);
+            void *p = create(f, n) ? mmap(NULL, new_bytes, PROT_READ|PROT_WRITE, MAP_SHARED, f, 0) : MAP_FAILED;
+            if (p==MAP_FAILED) {
+                close(f);
+                unlink(tmp.c_str());
+                return false;
+            }
+            CACHE_HEADER *h = (CACHE_HEADER *) p;
+            CACHE_SLOT *table = (CACHE_SLOT *) ((char *) p + sizeof(CACHE_HEADER));
+            for (UINT64 i=0; i<header->slots; i++) {
+                if (slots[i].k1!=0 || slots[i].k2!=0) {
+                    *probe(table, n, slots[i].k1, slots[i].k2) = slots[i];
+                    h->count++;
+                }
+            }
+            munmap(p, new_bytes);
+            if ((flock(f, LOCK_EX)!=0) || (rename(tmp.c_str(), path.c_str())!=0)) {
+                close(f);
+                unlink(tmp.c_str());
+                return false;
+            }
+            int old_fd = fd;
+            void *old_base = base;
+            size_t old_bytes = bytes;
+            fd = f;
+            if (!map()) {
+                close(f);
+                fd = old_fd;
+                base = old_base;
+                bytes = old_bytes;
+                return false;
+            }
+            munmap(old_base, old_bytes);
+            close(old_fd);
+            return true;
+        }
+
+        string path;
+        int fd;
+        void *base;
+        size_t bytes;
+        CACHE_HEADER *header;
+        CACHE_SLOT *slots;
+        bool full;
+        mutex m;
+};
+
+//--------------------------------------------------------------------
+#endif /* __RESULT_CACHE_HH__ */
@@ -0,0 +1,173 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+
+#ifndef __STREAM_READER_HH__
+#define __STREAM_READER_HH__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "common.hh"
+
+//--------------------------------------------------------------------
+// Sequential reader for inputs that cannot be mapped: stdin ("-"), named
+// pipes and gzip-compressed dumps (zlib reads plain data through as is).
+// A background thread reads and inflates into one of two buffers while the
+// caller works on the other one.
+class StreamReader {
+    public:
+        // batch: buffer size, rounded down to whole units (e.g. lines)
+        StreamReader(const char *name, size_t _batch, size_t unit)
+        : batch(_batch - _batch%unit), unit(unit), gz(NULL), done(false), stop(false), error(false), slot(0), consumed(-1) {
+            int fd = (strcmp(name, "-")==0) ? dup(0) : open(name, O_RDONLY);
+            if (fd>=0) {
+                gz = gzdopen(fd, "rb");
+            }
+            if (gz==NULL) {
+                if (fd>=0) {
+                    close(fd);
+                }
+                reason = strerror(errno);
+                error = done = true;
+                return;
+            }
+            gzbuffer(gz, 1<<20);
+            for (int k=0; k<2; k++) {
+                buf[k].resize(batch);
+                length[k] = 0;
+                filled[k] = false;
+            }
+            reader = thread(&StreamReader::fill, this);
+        }
+        ~StreamReader() {
+            {
+                lock_guard<mutex> lock(m);
+                stop = true;
+            }
+            cv.notify_all();
+            if (reader.joinable()) {
+                reader.join();
+            }
+            if (gz!=NULL) {
+                gzclose(gz);
+            }
+        }
+    private:
+        StreamReader(const StreamReader &);
+        StreamReader &operator=(const StreamReader &);
+    public:
+        // next batch of whole units, NULL at the end of the input
+        // : the batch stays valid until the next call
+        UINT8 *next(size_t *bytes) {
+            unique_lock<mutex> lock(m);
+            if (consumed>=0) {      // hand the previous batch back to the reader
+                filled[consumed] = false;
+                consumed = -1;
+                cv.notify_all();
+            }
+            cv.wait(lock, [this]() { return filled[slot] || done; });
+            if (!filled[slot]) {
+                return NULL;
+            }
+            *bytes = length[slot];
+            consumed = slot;
+            slot ^= 1;
+            return buf[consumed].data();
+        }
+        // open, read or inflate failure (the input ends there); valid once
+        // next() returned NULL
+        bool failed() const { return error; }
+        const char *failure() const { return reason.c_str(); }
+    protected:
+        void fill() {
+            for (int k=0; ; k^=1) {
+                {
+                    unique_lock<mutex> lock(m);
+                    cv.wait(lock, [this, k]() { return !filled[k] || stop; });
+                    if (stop) {
+                        return;
+                    }
+                }
+                // buffer k is ours until it is marked filled
+                size_t got = 0;
+                bool end = false;
+                bool failure = false;
+                while (got < batch) {
+                    int n = gzread(gz, buf[k].data()+got, (unsigned) min(batch-got, (size_t) (1<<30)));
+                    if (n<=0) {
+                        // a truncated .gz ends with 0 and Z_BUF_ERROR, not as a clean EOF
+                        int status;
+                        const char *msg = gzerror(gz, &status);
+                        failure = (n<0) || (status!=Z_OK);
+                        if (failure) {
+                            // zlib prefixes "<fd:N>: "
+                            const char *text = strstr(msg, ": ");
+                            reason = (status==Z_ERRNO) ? strerror(errno) : (text!=NULL) ? text+2 : msg;
+                        }
+                        end = true;
+                        break;
+                    }
+                    got += n;
+                }
+                {
+                    lock_guard<mutex> lock(m);
+                    length[k] = got - got%unit;     // a partial unit at the end is dropped
+                    filled[k] = (length[k]>0);
+                    error = failure;
+                    done = end;
+                }
+                cv.notify_all();
+                if (end) {
+                    return;
+                }
+            }
+        }
+    protected:
+        size_t batch;
+        size_t unit;
+        gzFile gz;
+        vector<UINT8> buf[2];
+        size_t length[2];
+        bool filled[2];
+        bool done;          // the reader reached the end of the input
+        bool stop;          // the reader is asked to quit
+        bool error;
+        string reason;      // of the failure
+        int slot;           // next batch for the caller
+        int consumed;       // batch the caller holds, -1 if none
+        thread reader;
+        mutex m;
+        condition_variable cv;
+};
+
+//--------------------------------------------------------------------
+#endif /* __STREAM_READER_HH__ */
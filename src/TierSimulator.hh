@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __TIER_SIMULATOR_HH__
+#define __TIER_SIMULATOR_HH__
+
+#include "common.hh"
+#include "PagePacker.hh"
+
+//--------------------------------------------------------------------
+// latency model (ns); override with -D on the g++ line
+#ifndef TIER_HIT_NS
+#define TIER_HIT_NS         (80)    // access to a decompressed page
+#endif
+#ifndef TIER_MISS_NS
+#define TIER_MISS_NS        (150)   // fetch of a compressed page, on top of the hit
+#endif
+#ifndef TIER_DECOMP_NS
+#define TIER_DECOMP_NS      (4)     // per compressed line of the fetched page
+#endif
+#ifndef TIER_COMP_NS
+#define TIER_COMP_NS        (8)     // per line of a dirty page written back
+#endif
+
+// one access of a trace: byte address in the snapshot (inputs concatenated,
+// the same numbering as the line_addr given to the compressors)
+typedef struct {
+    UINT64 addr;
+    bool write;
+} TRACE_ACCESS;
+
+// reads a text trace: one access per line, "[R|W] address" with a hex
+// (0x...) or decimal address; '#' starts a comment
+// : returns false if the file cannot be read
+bool loadTrace(const char *name, vector<TRACE_ACCESS> &trace) {
+    FILE *fd = fopen(name, "r");
+    if (fd==NULL) {
+        return false;
+    }
+    char buf[256];
+    while (fgets(buf, sizeof(buf), fd)!=NULL) {
+        char *p = buf;
+        while ((*p==' ') || (*p=='\t')) {
+            p++;
+        }
+        TRACE_ACCESS access = { 0ull, false };
+        if ((*p=='R') || (*p=='r') || (*p=='W') || (*p=='w')) {
+            access.write = (*p=='W') || (*p=='w');
+            p++;
+        }
+        char *end;
+        access.addr = strtoull(p, &end, 0);
+        if (end!=p) {
+            trace.push_back(access);
+        }
+    }
+    fclose(fd);
+    return true;
+}
+
+//--------------------------------------------------------------------
+// Compressed memory tier: every page of the snapshot lives in a compressed
+// store (sizes from PagePacker), and an LRU cache of decompressed pages sits
+// in front of it. A miss fetches the page and decompresses all of its
+// compressed lines; evicting a written page recompresses it.
+// A duplicate page (vsc -z) shares the data, and the cached copy, of the
+// page it duplicates.
+class TierSimulator {
+    public:
+        TierSimulator(const vector<PACKED_PAGE> &_pages, unsigned _cache_pages)
+        : pages(_pages), cache_pages(_cache_pages), accesses(0ull), outside(0ull), hits(0ull), decompressions(0ull), compressions(0ull), latency(0ull) {}
+    public:
+        void access(const TRACE_ACCESS &a) {
+            CNT page = a.addr/PAGE_SIZE;
+            if (page>=pages.size()) {
+                outside++;
+                return;
+            }
+            accesses++;
+            latency += TIER_HIT_NS;
+            if (pages[page].copy!=NO_COPY) {
+                page = pages[page].copy;
+            }
+            auto it = cached.find(page);
+            if (it!=cached.end()) {
+                hits++;
+                lru.splice(lru.begin(), lru, it->second);
+            } else {
+                if ((cache_pages>0) && (lru.size()>=cache_pages)) {
+                    evict();
+                }
+                decompressions += pages[page].compressed;
+                latency += TIER_MISS_NS + pages[page].compressed*TIER_DECOMP_NS;
+                if (cache_pages>0) {
+                    lru.push_front(CACHED_PAGE(page, false));
+                    cached[page] = lru.begin();
+                } else if (a.write) {   // no cache: written straight back
+                    compressions += pages[page].compressed;
+                    latency += pages[page].compressed*TIER_COMP_NS;
+                }
+            }
+            if (a.write && (cache_pages>0)) {
+                lru.front().second = true;
+            }
+        }
+        void print(FILE *fd, string name) const {
+            CNT store = 0ull;
+            for (auto p = pages.cbegin(); p != pages.cend(); ++p) {
+                store += p->bits/8;
+            }
+            CNT cache = (CNT) cache_pages*PAGE_SIZE;
+            CNT uncomp = (CNT) pages.size()*PAGE_SIZE;
+            fprintf(fd, "%s Tier accesses %lld hit_rate: %.4f decomp_lines/access: %.2f comp_lines/access: %.2f avg_latency: %.1f ns store %lld B + cache %lld B for %lld B capacity_gain: %.2f",
+                    name.c_str(), accesses, accesses ? hits*1./accesses : 0., accesses ? decompressions*1./accesses : 0., accesses ? compressions*1./accesses : 0.,
+                    accesses ? latency*1./accesses : 0., store, cache, uncomp, (store+cache) ? uncomp*1./(store+cache) : 0.);
+            if (outside>0) {
+                fprintf(fd, " (%lld accesses outside the snapshot skipped)", outside);
+            }
+            fprintf(fd, "\n");
+        }
+    protected:
+        void evict() {
+            const CACHED_PAGE &victim = lru.back();
+            if (victim.second) {
+                // the recompressed page is assumed to keep its packed size
+                compressions += pages[victim.first].compressed;
+                latency += pages[victim.first].compressed*TIER_COMP_NS;
+            }
+            cached.erase(victim.first);
+            lru.pop_back();
+        }
+    protected:
+        typedef pair<CNT, bool> CACHED_PAGE;    // page number, dirty
+        const vector<PACKED_PAGE> &pages;
+        unsigned cache_pages;
+        list<CACHED_PAGE> lru;                  // most recent first
+        map<CNT, list<CACHED_PAGE>::iterator> cached;
+        // statistics
+        CNT accesses;
+        CNT outside;
+        CNT hits;
+        CNT decompressions;     // lines
+        CNT compressions;       // lines
+        CNT latency;            // ns
+};
+
+//--------------------------------------------------------------------
+#endif /* __TIER_SIMULATOR_HH__ */
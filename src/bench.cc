@@ -0,0 +1,205 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <list>
+#include <vector>
+
+#include "common.hh"
+#include "BPCompressor.hh"
+#include "BDICompressor.hh"
+#include "CPackCompressor.hh"
+#include "FPCompressor.hh"
+
+// single-thread compressLine throughput over fixed synthetic corpora
+// : lines/s per core is what sizes a compression pass (cores = rate / per-core rate)
+
+typedef struct {
+    const char *name;
+    vector<CACHELINE_DATA> lines;
+} CORPUS;
+
+// fixed-seed generator, so every run times the same data
+static UINT64 bench_rand(UINT64 &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static void makeCorpora(vector<CORPUS> &corpora, CNT nlines) {
+    UINT64 state = 0x9E3779B97F4A7C15ull;
+    CORPUS c;
+
+    c.name = "zero";
+    c.lines.assign(nlines, CACHELINE_DATA());
+    memset(&c.lines[0], 0, nlines*sizeof(CACHELINE_DATA));
+    corpora.push_back(c);
+
+    // 8B-aligned heap pointers with small strides, a few NULLs
+    c.name = "pointer";
+    UINT64 ptr = 0x00007f3a5c000000ull;
+    for (CNT i=0; i<nlines; i++) {
+        for (int j=0; j<_MAX_QWORDS_PER_LINE; j++) {
+            UINT64 r = bench_rand(state);
+            ptr += (r & 0xF8) + 8;
+            c.lines[i].qword[j] = ((r>>8)%16==0) ? 0ull : ptr;
+        }
+    }
+    corpora.push_back(c);
+
+    // counters / indices: slowly growing ints with small noise
+    c.name = "int";
+    INT32 value = 1000;
+    for (CNT i=0; i<nlines; i++) {
+        for (int j=0; j<_MAX_DWORDS_PER_LINE; j++) {
+            UINT64 r = bench_rand(state);
+            value += (INT32) (r%16) - 4;
+            c.lines[i].dword[j] = value + (INT32) ((r>>8)%8);
+        }
+    }
+    corpora.push_back(c);
+
+    // smooth single-precision series
+    c.name = "float";
+    for (CNT i=0; i<nlines; i++) {
+        for (int j=0; j<_MAX_DWORDS_PER_LINE; j++) {
+            UINT64 r = bench_rand(state);
+            FLT32 f = (FLT32) (100.0*sin((i*_MAX_DWORDS_PER_LINE+j)*0.001) + (r%1000)*1e-4);
+            memcpy(&c.lines[i].dword[j], &f, sizeof(f));
+        }
+    }
+    corpora.push_back(c);
+
+    c.name = "random";
+    for (CNT i=0; i<nlines; i++) {
+        for (int j=0; j<_MAX_QWORDS_PER_LINE; j++) {
+            c.lines[i].qword[j] = bench_rand(state);
+        }
+    }
+    corpora.push_back(c);
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// seconds for one pass over a corpus; bits collects the output
+// : batch lines per compressLines() call, 0 -> one compressLine() call per line
+static double timePass(Compressor *comp, const CORPUS &corpus, CNT batch, CNT &bits) {
+    comp->reset();
+    vector<CACHELINE_DATA> &lines = const_cast<vector<CACHELINE_DATA> &>(corpus.lines);
+    vector<LENGTH> length(lines.size());
+    double start = now();
+    if (batch==0) {
+        for (CNT i=0; i<lines.size(); i++) {
+            length[i] = comp->compressLine(&lines[i], i*(LSIZE/8));
+        }
+    } else {
+        for (CNT i=0; i<lines.size(); i+=batch) {
+            comp->compressLines(&lines[i], min(batch, (CNT) lines.size()-i), i*(LSIZE/8), &length[i]);
+        }
+    }
+    double sec = now() - start;
+    bits = 0ull;
+    for (CNT i=0; i<lines.size(); i++) {
+        bits += length[i];
+    }
+    return sec;
+}
+
+//usage:./vsc_bench [-n lines] [-r repetitions] [-w warmup passes] [-b batch lines]
+int main(int argc, char **argv)
+{
+    CNT nlines = 16384;     // 1MB per corpus (64B lines)
+    int reps = 5;
+    int warmup = 1;
+    CNT batch = 64;         // a 4KB page of 64B lines, as vsc does
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:w:b:")) != -1) {
+        if (opt=='n') {
+            nlines = atoll(optarg);
+        } else if (opt=='r') {
+            reps = atoi(optarg);
+        } else if (opt=='w') {
+            warmup = atoi(optarg);
+        } else if (opt=='b') {
+            batch = atoll(optarg);
+        } else {
+            return 1;
+        }
+    }
+    assert((nlines>0) && (reps>0) && (warmup>=0));
+
+    vector<CORPUS> corpora;
+    makeCorpora(corpora, nlines);
+
+    // BPCompressor / BPCompressor64 are left out: they assert / read out of bounds
+    list<Compressor *> comps;
+    comps.push_back(new BDICompressorQW());
+    comps.push_back(new BDCompressorQW());
+    comps.push_back(new FPCompressorDW());
+    comps.push_back(new CPackCompressor());
+    comps.push_back(createBPSCompressorDW("BPS-DW_5_4_10", 5, 4, 10, 9));
+    comps.push_back(createBPSCompressorDW("BPS-DW_5_4_11", 5, 4, 11, 9));
+    comps.push_back(createBPSCompressorDW("BPS-DW_5_4_12", 5, 4, 12, 9));
+    comps.push_back(new BPSCompressor64("BPS-64_2_4_10", 2, 4, 10, 9));
+
+    printf("%-16s %-8s %12s %10s %10s %10s %10s\n", "compressor", "corpus", "lines/s", "GB/s", "ns/line", "min ns", "ratio");
+    for (auto it = comps.cbegin(); it != comps.cend(); ++it) {
+        for (auto c = corpora.cbegin(); c != corpora.cend(); ++c) {
+            CNT bits;
+            for (int i=0; i<warmup; i++) {
+                timePass(*it, *c, batch, bits);
+            }
+            // median and best of the timed passes
+            vector<double> sec(reps);
+            for (int i=0; i<reps; i++) {
+                sec[i] = timePass(*it, *c, batch, bits);
+            }
+            sort(sec.begin(), sec.end());
+            double median = sec[reps/2];
+            double nsPerLine = median*1e9/c->lines.size();
+            printf("%-16s %-8s %12.0f %10.3f %10.2f %10.2f %10.2f\n",
+                    (*it)->getName().c_str(), c->name,
+                    c->lines.size()/median,
+                    c->lines.size()*(LSIZE/8)/median/1e9,
+                    nsPerLine,
+                    sec[0]*1e9/c->lines.size(),
+                    (double) c->lines.size()*LSIZE/bits);
+        }
+        delete *it;
+    }
+}
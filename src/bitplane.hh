@@ -0,0 +1,181 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __BITPLANE_HH__
+#define __BITPLANE_HH__
+
+#include "common.hh"
+
+// define BP_NO_SIMD to always use the scalar bit-plane loops
+#if (defined(__x86_64__) || defined(__i386__)) && ((LSIZE%256)==0) && !defined(BP_NO_SIMD)
+#define BP_SIMD
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Bit-plane transpose of a line worth of dwords
+//   bit i of plane[j] = bit j of src[i]
+// The scalar loops in BPCompressor.hh are the reference; these kernels
+// must produce bit-identical planes.
+typedef void (*BP_TRANSPOSE_FUNC)(const UINT32 *src, UINT32 *plane);
+
+#ifdef BP_SIMD
+__attribute__((target("sse2")))
+static void bp_transpose_sse2(const UINT32 *src, UINT32 *plane) {
+    __m128i v[_MAX_DWORDS_PER_LINE/4];
+    for (int k=0; k<_MAX_DWORDS_PER_LINE/4; k++) {
+        v[k] = _mm_loadu_si128((const __m128i *) &src[k*4]);
+    }
+    // movemask collects the MSB of each dword -> start from bit 31
+    for (int j=31; j>=0; j--) {
+        UINT32 buf = 0;
+        for (int k=0; k<_MAX_DWORDS_PER_LINE/4; k++) {
+            buf |= ((UINT32) _mm_movemask_ps(_mm_castsi128_ps(v[k]))) << (k*4);
+            v[k] = _mm_slli_epi32(v[k], 1);
+        }
+        plane[j] = buf;
+    }
+}
+
+__attribute__((target("avx2")))
+static void bp_transpose_avx2(const UINT32 *src, UINT32 *plane) {
+    __m256i v[_MAX_DWORDS_PER_LINE/8];
+    for (int k=0; k<_MAX_DWORDS_PER_LINE/8; k++) {
+        v[k] = _mm256_loadu_si256((const __m256i *) &src[k*8]);
+    }
+    for (int j=31; j>=0; j--) {
+        UINT32 buf = 0;
+        for (int k=0; k<_MAX_DWORDS_PER_LINE/8; k++) {
+            buf |= ((UINT32) _mm256_movemask_ps(_mm256_castsi256_ps(v[k]))) << (k*8);
+            v[k] = _mm256_slli_epi32(v[k], 1);
+        }
+        plane[j] = buf;
+    }
+}
+#endif
+
+static BP_TRANSPOSE_FUNC bp_select_transpose() {
+#ifdef BP_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return bp_transpose_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return bp_transpose_sse2;
+    }
+#endif
+    return NULL;
+}
+
+// NULL if no vector kernel is usable -> callers keep their scalar loop
+static BP_TRANSPOSE_FUNC bp_transpose = bp_select_transpose();
+
+// DBP, DBX and DBX2 planes of a (transformed) line
+//   DBX : bit j XOR bit j+1 (bit 31 as is)  -> planes of (d ^ d>>1)
+//   DBX2: bit j XOR bit 31  (bit 31 as is)  -> planes of (d ^ sign(d)>>1)
+// dbx2 may be NULL when the caller does not need it.
+static void bp_build_planes(const UINT32 *src, UINT32 *dbp, UINT32 *dbx, UINT32 *dbx2) {
+    UINT32 buf[_MAX_DWORDS_PER_LINE];
+
+    bp_transpose(src, dbp);
+    for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+        buf[i] = src[i] ^ (src[i]>>1);
+    }
+    bp_transpose(buf, dbx);
+    if (dbx2!=NULL) {
+        for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            buf[i] = src[i] ^ (((UINT32) (((INT32) src[i])>>31))>>1);
+        }
+        bp_transpose(buf, dbx2);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Inverse transpose of 32 bit-planes back into a line worth of dwords
+//   bit j of dst[i] = bit i of plane[j]
+static void bp_inverse_transpose_scalar(const UINT32 *plane, UINT32 *dst) {
+    for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+        UINT32 buf = 0;
+        for (int j=31; j>=0; j--) {
+            buf <<= 1;
+            buf |= ((plane[j]>>i)&1);
+        }
+        dst[i] = buf;
+    }
+}
+
+#ifdef BP_SIMD
+__attribute__((target("sse2")))
+static void bp_inverse_transpose_sse2(const UINT32 *plane, UINT32 *dst) {
+    __m128i v[8];
+    // bring bit (_MAX_DWORDS_PER_LINE-1) of each plane to the MSB
+    for (int k=0; k<8; k++) {
+        v[k] = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) &plane[k*4]), 32-_MAX_DWORDS_PER_LINE);
+    }
+    for (int i=_MAX_DWORDS_PER_LINE-1; i>=0; i--) {
+        UINT32 buf = 0;
+        for (int k=0; k<8; k++) {
+            buf |= ((UINT32) _mm_movemask_ps(_mm_castsi128_ps(v[k]))) << (k*4);
+            v[k] = _mm_slli_epi32(v[k], 1);
+        }
+        dst[i] = buf;
+    }
+}
+
+__attribute__((target("avx2")))
+static void bp_inverse_transpose_avx2(const UINT32 *plane, UINT32 *dst) {
+    __m256i v[4];
+    for (int k=0; k<4; k++) {
+        v[k] = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i *) &plane[k*8]), 32-_MAX_DWORDS_PER_LINE);
+    }
+    for (int i=_MAX_DWORDS_PER_LINE-1; i>=0; i--) {
+        UINT32 buf = 0;
+        for (int k=0; k<4; k++) {
+            buf |= ((UINT32) _mm256_movemask_ps(_mm256_castsi256_ps(v[k]))) << (k*8);
+            v[k] = _mm256_slli_epi32(v[k], 1);
+        }
+        dst[i] = buf;
+    }
+}
+#endif
+
+static BP_TRANSPOSE_FUNC bp_select_inverse_transpose() {
+#ifdef BP_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return bp_inverse_transpose_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return bp_inverse_transpose_sse2;
+    }
+#endif
+    return bp_inverse_transpose_scalar;
+}
+
+static BP_TRANSPOSE_FUNC bp_inverse_transpose = bp_select_inverse_transpose();
+
+#endif /* __BITPLANE_HH__ */
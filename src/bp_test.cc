@@ -0,0 +1,165 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <map>
+#include <vector>
+
+#include "common.hh"
+#include "bitplane.hh"
+
+// checks the vector bit-plane kernels (bitplane.hh) against a plain
+// per-bit transpose on edge-case and random lines; build once per LSIZE
+// (make test)
+
+static UINT64 test_rand(UINT64 &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// bit i of plane[j] = bit j of src[i]
+static void ref_transpose(const UINT32 *src, UINT32 *plane) {
+    for (int j=0; j<32; j++) {
+        plane[j] = 0;
+        for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            plane[j] |= ((src[i]>>j)&1) << i;
+        }
+    }
+}
+
+// bit j of dst[i] = bit i of plane[j]
+static void ref_inverse_transpose(const UINT32 *plane, UINT32 *dst) {
+    for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+        dst[i] = 0;
+        for (int j=0; j<32; j++) {
+            dst[i] |= ((plane[j]>>i)&1) << j;
+        }
+    }
+}
+
+static void makeLines(vector<CACHELINE_DATA> &lines) {
+    CACHELINE_DATA line;
+    static const UINT32 fill[] = { 0x00000000, 0xFFFFFFFF, 0x55555555, 0xAAAAAAAA, 0x80000000, 0x7FFFFFFF, 0x00000001, 0xFFFFFFFE };
+    for (unsigned f=0; f<sizeof(fill)/sizeof(fill[0]); f++) {
+        for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            line.dword[i] = fill[f];
+        }
+        lines.push_back(line);
+    }
+    // one set bit, walked over every position of the line
+    for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+        for (int j=0; j<32; j++) {
+            memset(&line, 0, sizeof(line));
+            line.dword[i] = 1u << j;
+            lines.push_back(line);
+        }
+    }
+    UINT64 state = 0x9E3779B97F4A7C15ull;
+    for (int n=0; n<10000; n++) {
+        for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            UINT64 r = test_rand(state);
+            // full-width, small signed and sparse values
+            line.dword[i] = ((r>>62)==0) ? (UINT32) r : ((r>>62)==1) ? (UINT32) (((INT32) r)>>20) : (UINT32) (r & (r>>32) & (r>>16));
+        }
+        lines.push_back(line);
+    }
+}
+
+static int checkTranspose(const char *name, BP_TRANSPOSE_FUNC transpose, const vector<CACHELINE_DATA> &lines) {
+    int errors = 0;
+    for (auto l = lines.cbegin(); l != lines.cend(); ++l) {
+        UINT32 expect[32], got[32];
+        ref_transpose(l->dword, expect);
+        transpose(l->dword, got);
+        errors += (memcmp(expect, got, sizeof(expect))!=0);
+    }
+    printf("  %-24s %s\n", name, errors ? "FAILED" : "ok");
+    return errors;
+}
+
+static int checkInverse(const char *name, BP_TRANSPOSE_FUNC inverse, const vector<CACHELINE_DATA> &lines) {
+    int errors = 0;
+    for (auto l = lines.cbegin(); l != lines.cend(); ++l) {
+        // the line's dwords (and their complements) as 32 planes
+        UINT32 plane[32], expect[_MAX_DWORDS_PER_LINE], got[_MAX_DWORDS_PER_LINE];
+        for (int j=0; j<32; j++) {
+            plane[j] = (j<_MAX_DWORDS_PER_LINE) ? l->dword[j] : ~l->dword[j-_MAX_DWORDS_PER_LINE];
+        }
+        ref_inverse_transpose(plane, expect);
+        inverse(plane, got);
+        errors += (memcmp(expect, got, sizeof(expect))!=0);
+    }
+    printf("  %-24s %s\n", name, errors ? "FAILED" : "ok");
+    return errors;
+}
+
+// DBP / DBX / DBX2 planes of bp_build_planes (dispatched transpose)
+static int checkBuildPlanes(const vector<CACHELINE_DATA> &lines) {
+    int errors = 0;
+    for (auto l = lines.cbegin(); l != lines.cend(); ++l) {
+        UINT32 dbx_src[_MAX_DWORDS_PER_LINE], dbx2_src[_MAX_DWORDS_PER_LINE];
+        for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            dbx_src[i] = l->dword[i] ^ (l->dword[i]>>1);
+            dbx2_src[i] = l->dword[i] ^ (((UINT32) (((INT32) l->dword[i])>>31))>>1);
+        }
+        UINT32 dbp[32], dbx[32], dbx2[32], got_dbp[32], got_dbx[32], got_dbx2[32];
+        ref_transpose(l->dword, dbp);
+        ref_transpose(dbx_src, dbx);
+        ref_transpose(dbx2_src, dbx2);
+        bp_build_planes(l->dword, got_dbp, got_dbx, got_dbx2);
+        errors += (memcmp(dbp, got_dbp, sizeof(dbp))!=0) || (memcmp(dbx, got_dbx, sizeof(dbx))!=0) || (memcmp(dbx2, got_dbx2, sizeof(dbx2))!=0);
+    }
+    printf("  %-24s %s\n", "bp_build_planes", errors ? "FAILED" : "ok");
+    return errors;
+}
+
+int main() {
+    vector<CACHELINE_DATA> lines;
+    makeLines(lines);
+    printf("bit-plane kernels, %d B lines, %zu lines\n", LSIZE/8, lines.size());
+
+    int errors = checkInverse("inverse scalar", bp_inverse_transpose_scalar, lines);
+#ifdef BP_SIMD
+    errors += checkTranspose("transpose sse2", bp_transpose_sse2, lines);
+    errors += checkInverse("inverse sse2", bp_inverse_transpose_sse2, lines);
+    if (__builtin_cpu_supports("avx2")) {
+        errors += checkTranspose("transpose avx2", bp_transpose_avx2, lines);
+        errors += checkInverse("inverse avx2", bp_inverse_transpose_avx2, lines);
+    } else {
+        printf("  avx2 not supported, skipped\n");
+    }
+    errors += checkBuildPlanes(lines);
+#else
+    printf("  vector kernels not built (BP_NO_SIMD)\n");
+#endif
+    return (errors==0) ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <map>
+#include <list>
+#include <vector>
+
+#include "common.hh"
+#include "BPCompressor.hh"
+#include "BDICompressor.hh"
+#include "CPackCompressor.hh"
+
+// round trip of the line codecs: decodeLine(encodeLine(x)) == x for the
+// BPC bitstream (BPSCompressorDW 5,4,12), BDI-QW and C-Pack, and encodeLine
+// lengths against compressLine; build once per LSIZE, with and without
+// -DBP_NO_SIMD for both inverse-transpose paths (make test)
+
+static UINT64 test_rand(UINT64 &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// lines of every kind the codecs tell apart
+static void makeLines(vector<CACHELINE_DATA> &lines) {
+    UINT64 state = 0x9E3779B97F4A7C15ull;
+    CACHELINE_DATA line;
+    for (int n=0; n<20000; n++) {
+        UINT64 r = test_rand(state);
+        UINT64 base = test_rand(state);
+        for (int i=0; i<_MAX_QWORDS_PER_LINE; i++) {
+            UINT64 v = test_rand(state);
+            switch (n%10) {
+                case 0:  line.qword[i] = 0ull;                                        break;
+                case 1:  line.qword[i] = base;                                        break;
+                case 2:  line.qword[i] = base + (INT8) v;                             break;    // base8 + delta1
+                case 3:  line.qword[i] = (v & 1) ? (INT64) (INT8) v : base + (INT16) v; break;  // with immediates
+                case 4:  line.dword[2*i] = (UINT32) base + (INT8) v;                  // base4 + delta1
+                         line.dword[2*i+1] = (UINT32) base + (INT8) (v>>8);           break;
+                case 5:  line.qword[i] = (INT64) (INT32) (v>>40);                     break;    // small signed ints
+                case 6:  line.qword[i] = (v & 0x0000FFFF0000FFFFull) | ((r & 0xFF00FF00ull)<<16); break;
+                case 7:  line.qword[i] = (v>>(v%64)) & ((r & 1) ? ~0ull : 0xFFFFFFull); break;  // sparse
+                case 8:  line.qword[i] = 0x00007f3a5c000000ull + (base & 0xFFFF) + i*8*(r%4); break;  // pointers
+                default: line.qword[i] = v;
+            }
+        }
+        lines.push_back(line);
+    }
+    // dwords that hit the plane special cases (all ones, two consecutive, ...)
+    static const UINT32 fill[] = { 0xFFFFFFFF, 0x80000000, 0x7FFFFFFF, 0x00000003, 0xFFFFFFFE };
+    for (unsigned f=0; f<sizeof(fill)/sizeof(fill[0]); f++) {
+        for (int i=0; i<_MAX_DWORDS_PER_LINE; i++) {
+            line.dword[i] = (i%2) ? fill[f] : fill[f]*i;
+        }
+        lines.push_back(line);
+    }
+}
+
+static int report(const char *name, int errors) {
+    printf("  %-24s %s\n", name, errors ? "FAILED" : "ok");
+    return errors;
+}
+
+// the bitstream length is compressLine's length once frag_mode >= 4
+static int checkBPC(const vector<CACHELINE_DATA> &lines) {
+    int errors = 0;
+    BPSCompressorDW comp("BPS-DW_5_4_12_4", 5, 4, 12, 4);
+    UINT8 buf[_MAX_BYTES_PER_LINE];
+    for (auto l = lines.cbegin(); l != lines.cend(); ++l) {
+        CACHELINE_DATA in = *l, out;
+        LENGTH length = comp.encodeLine(&in, buf);
+        comp.decodeLine(buf, length, &out);
+        errors += (memcmp(&in, &out, sizeof(in))!=0) || (length!=comp.compressLine(&in, 0));
+    }
+    return report("BPC 5,4,12", errors);
+}
+
+// the stored encoding is the one compressLine counts
+static int checkBDI(const vector<CACHELINE_DATA> &lines) {
+    int errors = 0;
+    BDICompressorQW comp;
+    UINT8 buf[_MAX_BYTES_PER_LINE+1];
+    for (auto l = lines.cbegin(); l != lines.cend(); ++l) {
+        CACHELINE_DATA in = *l, out;
+        LENGTH length = comp.encodeLine(&in, buf);
+        comp.decodeLine(buf, &out);
+        errors += (memcmp(&in, &out, sizeof(in))!=0) || (buf[0]!=comp.getEncoding(&in)) || (length>(LENGTH) (_MAX_BYTES_PER_LINE+1)*8);
+    }
+    return report("BDI-QW", errors);
+}
+
+static int checkCPack(const vector<CACHELINE_DATA> &lines) {
+    int errors = 0;
+    for (int entries=8; entries<=64; entries*=2) {
+        char name[32];
+        snprintf(name, sizeof(name), "C-Pack64_%d", entries);
+        CPackCompressor comp(name, entries);
+        UINT8 buf[_MAX_BYTES_PER_LINE];
+        int bad = 0;
+        for (auto l = lines.cbegin(); l != lines.cend(); ++l) {
+            CACHELINE_DATA in = *l, out;
+            LENGTH length = comp.encodeLine(&in, buf);
+            comp.decodeLine(buf, length, &out);
+            bad += (memcmp(&in, &out, sizeof(in))!=0) || (length!=min(comp.compressLine(&in, 0), (LENGTH) LSIZE));
+        }
+        errors += report(name, bad);
+    }
+    return errors;
+}
+
+int main() {
+    vector<CACHELINE_DATA> lines;
+    makeLines(lines);
+#ifdef BP_SIMD
+    const char *inverse = (bp_inverse_transpose==bp_inverse_transpose_scalar) ? "scalar" : "vector";
+#else
+    const char *inverse = "scalar";
+#endif
+    printf("codec round trip, %d B lines, %zu lines, %s inverse transpose\n", LSIZE/8, lines.size(), inverse);
+    int errors = checkBPC(lines);
+    errors += checkBDI(lines);
+    errors += checkCPack(lines);
+    return (errors==0) ? 0 : 1;
+}
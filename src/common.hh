@@ -39,8 +39,11 @@
 #include <assert.h>
 
 //--------------------------------------------------------------------
+// line size; the vsc driver is also built for other sizes (see lsize*.cc)
+#ifndef LSIZE
 #define LSIZE (512)  // in bits
 //#define LSIZE (1024)  // in bits
+#endif
 
 #define EXC (0.3) // Exception percent for LCP
 
@@ -74,6 +77,8 @@ typedef unsigned long long  CNT;
 typedef unsigned            LENGTH;
 typedef unsigned long long  KEY;
 
+#include "PhaseTimer.hh"
+
 static const INT32 _MAX_BYTES_PER_LINE     = LSIZE/8;
 static const INT32 _MAX_WORDS_PER_LINE     = LSIZE/16;
 static const INT32 _MAX_DWORDS_PER_LINE    = LSIZE/32;
@@ -81,6 +86,10 @@ static const INT32 _MAX_QWORDS_PER_LINE    = LSIZE/64;
 static const INT32 _MAX_FLOATS_PER_LINE    = LSIZE/32;
 static const INT32 _MAX_DOUBLES_PER_LINE   = LSIZE/64;
 
+// statistics kept in dense counters; other keys go to a sparse map
+static const INT32 _MAX_PATTERN_ID         = 1024;
+static const INT32 _MAX_LENGTH             = LSIZE+4;
+
 typedef struct { UINT64 m : 52; UINT64 e : 11; UINT64 s : 1; } FLT64_P;
 typedef struct { UINT32 m : 23; UINT32 e : 8;  UINT32 s : 1; } FLT32_P;
 
@@ -106,22 +115,106 @@ typedef union BITPLANE_DATA {
     UINT32  dword[32];
 } BITPLANE_DATA;
 //--------------------------------------------------------------------
+// Compressor::compressLines() of a compressor class: direct (inlinable) calls
+#define COMPRESS_LINES(CLASS) \
+    void compressLines(CACHELINE_DATA* lines, size_t n, UINT64 line_addr, LENGTH* out) { \
+        for (size_t i=0; i<n; i++) { \
+            out[i] = CLASS::compressLine(&lines[i], line_addr+i*_MAX_BYTES_PER_LINE); \
+        } \
+    }
+
 class Compressor {
     public:
         // constructor / destructor        
-        Compressor(const string _name) : name(_name) { }
-        ~Compressor() {}
+        Compressor(const string _name) : name(_name), totalPatternCnt(0ull), totalLineCnt(0ull), patternCounter(), lengthCounter() {
+#ifdef PHASE_TIMING
+            memset(&phases, 0, sizeof(phases));
+#endif
+        }
+        virtual ~Compressor() {}
     public:
         // methods
         string getName() const { return name; }
-        CNT getPatternCnt(INT64 pattern) { auto it = patternCounterMap.find(pattern); return (it==patternCounterMap.end()) ? 0 : it->second; }
+        CNT getPatternCnt(INT64 pattern) const {
+            if ((pattern>=0) && (pattern<_MAX_PATTERN_ID)) {
+                return patternCounter[pattern];
+            }
+            auto it = patternCounterMap.find(pattern);
+            return (it==patternCounterMap.end()) ? 0 : it->second;
+        }
+        CNT getLengthCnt(LENGTH length) const {
+            if (length<=(LENGTH) _MAX_LENGTH) {
+                return lengthCounter[length];
+            }
+            auto it = lengthMap.find(length);
+            return (it==lengthMap.end()) ? 0 : it->second;
+        }
+        // all non-zero counters, ordered by key (for reports)
+        map<INT64, CNT> getPatternCounts() const {
+            map<INT64, CNT> counts(patternCounterMap);
+            for (INT64 i=0; i<_MAX_PATTERN_ID; i++) {
+                if (patternCounter[i]!=0) {
+                    counts.insert(pair<INT64, CNT>(i, patternCounter[i]));
+                }
+            }
+            return counts;
+        }
+        map<LENGTH, CNT> getLengthCounts() const {
+            map<LENGTH, CNT> counts(lengthMap);
+            for (LENGTH i=0; i<=(LENGTH) _MAX_LENGTH; i++) {
+                if (lengthCounter[i]!=0) {
+                    counts.insert(pair<LENGTH, CNT>(i, lengthCounter[i]));
+                }
+            }
+            return counts;
+        }
 
         virtual LENGTH compressLine(CACHELINE_DATA* line, UINT64 line_addr) = 0;
+        // compresses n consecutive lines (the first at line_addr), lengths to out
+        // : compressors override it with COMPRESS_LINES() to drop the virtual call per line
+        virtual void compressLines(CACHELINE_DATA* lines, size_t n, UINT64 line_addr, LENGTH* out) {
+            for (size_t i=0; i<n; i++) {
+                out[i] = compressLine(&lines[i], line_addr+i*_MAX_BYTES_PER_LINE);
+            }
+        }
+        // a fresh copy with the same configuration (one per worker thread)
+        virtual Compressor *clone() const = 0;
         virtual void reset() {
             totalPatternCnt = 0ull;
             totalLineCnt = 0ull;
+            fill(patternCounter, patternCounter+_MAX_PATTERN_ID, 0ull);
+            fill(lengthCounter, lengthCounter+_MAX_LENGTH+1, 0ull);
             patternCounterMap.clear();
             lengthMap.clear();
+#ifdef PHASE_TIMING
+            memset(&phases, 0, sizeof(phases));
+#endif
+        }
+        // restore inter-line state (e.g. previous data for delta) from the line
+        // right before a chunk, without compressing or counting it
+        virtual void seed(CACHELINE_DATA* prev_line) {}
+        // adds the statistics of another instance (e.g. a worker's clone)
+        virtual void mergeStatistics(const Compressor &other) {
+            totalPatternCnt += other.totalPatternCnt;
+            totalLineCnt += other.totalLineCnt;
+            for (INT64 i=0; i<_MAX_PATTERN_ID; i++) {
+                patternCounter[i] += other.patternCounter[i];
+            }
+            for (LENGTH i=0; i<=(LENGTH) _MAX_LENGTH; i++) {
+                lengthCounter[i] += other.lengthCounter[i];
+            }
+            for (auto it = other.patternCounterMap.cbegin(); it != other.patternCounterMap.cend(); ++it) {
+                patternCounterMap[it->first] += it->second;
+            }
+            for (auto it = other.lengthMap.cbegin(); it != other.lengthMap.cend(); ++it) {
+                lengthMap[it->first] += it->second;
+            }
+#ifdef PHASE_TIMING
+            for (int p=0; p<PHASES; p++) {
+                phases.ticks[p] += other.phases.ticks[p];
+                phases.calls[p] += other.phases.calls[p];
+            }
+#endif
         }
 
     protected:
@@ -139,6 +232,10 @@ class Compressor {
         }
         virtual void countPattern(INT64 pattern) {
             totalPatternCnt++;
+            if ((pattern>=0) && (pattern<_MAX_PATTERN_ID)) {
+                patternCounter[pattern]++;
+                return;
+            }
             auto it = patternCounterMap.find(pattern);
             if (it==patternCounterMap.end()) {
                 patternCounterMap.insert(pair<INT64, CNT>(pattern, 1ull));
@@ -146,8 +243,23 @@ class Compressor {
                 it->second++;
             }
         }
+        // n occurrences of a pattern at once
+        void countPatterns(INT64 pattern, CNT n) {
+            totalPatternCnt += n;
+            if ((pattern>=0) && (pattern<_MAX_PATTERN_ID)) {
+                patternCounter[pattern] += n;
+                return;
+            }
+            if (n!=0) {
+                patternCounterMap[pattern] += n;
+            }
+        }
         virtual void countLineResult(LENGTH length) {
             totalLineCnt++;
+            if (length<=(LENGTH) _MAX_LENGTH) {
+                lengthCounter[length]++;
+                return;
+            }
             auto it = lengthMap.find(length);
             if (it==lengthMap.end()) {
                 lengthMap.insert(pair<LENGTH, CNT>(length, 1ull));
@@ -158,16 +270,14 @@ class Compressor {
         double getCoverage(int thresholdBitSize) {
             CNT accumLineCnt = 0ull;
             for (int i=0; i<=thresholdBitSize; i++) {
-                auto it = lengthMap.find(i);
-                if (it!=lengthMap.end()) {
-                    accumLineCnt += it->second;
-                }
+                accumLineCnt += getLengthCnt(i);
             }
             return accumLineCnt*1./totalLineCnt;
         }
     public:
         virtual void printSummary(FILE* fd) {
             CNT accumCnt;
+            map<LENGTH, CNT> lengthCnts = getLengthCounts();
 
             fprintf(fd, "Comp\t%s\n", name.c_str());
             // Input bench data
@@ -175,7 +285,7 @@ class Compressor {
 
             // Compression results
             accumCnt = 0ull;
-            for (auto it = lengthMap.begin(); it != lengthMap.end(); ++it) {
+            for (auto it = lengthCnts.begin(); it != lengthCnts.end(); ++it) {
                 accumCnt += (it->first * it->second);
             }
             fprintf(fd, "compratio  \t%f\n", totalLineCnt*_MAX_DWORDS_PER_LINE*32./accumCnt);
@@ -197,6 +307,28 @@ class Compressor {
               */
         }
 
+#ifdef PHASE_TIMING
+        // compressLine time per phase (PhaseTimer.hh); nothing if not instrumented
+        void printPhases(FILE* fd) const {
+            CNT total = 0ull;
+            for (int p=0; p<PHASES; p++) {
+                total += phases.ticks[p];
+            }
+            if (total==0) {
+                return;
+            }
+            fprintf(fd, "Phases\t%s\t(%s)\n", name.c_str(), PHASE_UNIT);
+            fprintf(fd, "  %-10s %14s %14s %10s %7s\n", "phase", "calls", PHASE_UNIT, "per call", "share");
+            for (int p=0; p<PHASES; p++) {
+                if (phases.calls[p]==0) {
+                    continue;
+                }
+                fprintf(fd, "  %-10s %14lld %14lld %10.1f %6.1f%%\n", PHASE_NAMES[p], phases.calls[p], phases.ticks[p],
+                        phases.ticks[p]*1./phases.calls[p], phases.ticks[p]*100./total);
+            }
+        }
+#endif
+
         virtual void printLCPSummary(FILE* fd, CNT accumCnt) {
             fprintf(fd, "Comp\t%s\n", name.c_str());
             // Input bench data
@@ -209,13 +341,16 @@ class Compressor {
             fprintf(fd, "Comp8b     \t%f\n", accumCnt*1./totalLineCnt/_MAX_BYTES_PER_LINE);
         }
         virtual void printDetails(FILE* fd, string bench_name) const {
+            map<INT64, CNT> patternCnts = getPatternCounts();
+            map<LENGTH, CNT> lengthCnts = getLengthCounts();
+
             fprintf(fd, "Pattern frequency\n");
             // if too huge
-            if (patternCounterMap.size() > (1<<16)) {
+            if (patternCnts.size() > (1<<16)) {
                 map<INT64, CNT> patternGroupCounterMap;
                 // group into 65536 groups
                 int offset = 48;
-                for (auto it = patternCounterMap.begin(); it != patternCounterMap.end(); ++it) {
+                for (auto it = patternCnts.begin(); it != patternCnts.end(); ++it) {
                     INT64 patternGroup = it->first>>offset;
                     auto it2 = patternGroupCounterMap.find(patternGroup);
                     if (it2 == patternGroupCounterMap.end()) {
@@ -250,7 +385,7 @@ class Compressor {
             } else {
                 if (true) {     // sorted based on pattern
                     vector<pair<INT64, CNT>>v;
-                    for (auto it = patternCounterMap.begin(); it != patternCounterMap.end(); ++it) {
+                    for (auto it = patternCnts.begin(); it != patternCnts.end(); ++it) {
                         v.push_back(pair<INT64, CNT>(it->first, it->second));
                     }
                     // sorting
@@ -261,7 +396,7 @@ class Compressor {
                     }
                 } else {        // sorted based on frequency
                     vector<pair<CNT, INT64>>v;
-                    for (auto it = patternCounterMap.begin(); it != patternCounterMap.end(); ++it) {
+                    for (auto it = patternCnts.begin(); it != patternCnts.end(); ++it) {
                         v.push_back(pair<INT64, CNT>(it->second, it->first));
                     }
                     // sorting
@@ -274,7 +409,7 @@ class Compressor {
             }
 
             fprintf(fd, "Compressed line size\n");
-            for (auto it=lengthMap.begin(); it!=lengthMap.end(); it++) {
+            for (auto it=lengthCnts.begin(); it!=lengthCnts.end(); it++) {
                 fprintf(fd, "%02d\t%f\t%f\n", it->first, it->second*1./ totalLineCnt, -log2(it->second*1./totalLineCnt));
             }
         }
@@ -283,12 +418,25 @@ class Compressor {
 
         CNT totalPatternCnt;
         CNT totalLineCnt;
-        map<INT64, CNT> patternCounterMap;
-        map<LENGTH, CNT> lengthMap;
+        CNT patternCounter[_MAX_PATTERN_ID];
+        CNT lengthCounter[_MAX_LENGTH+1];
+        map<INT64, CNT> patternCounterMap;     // patterns out of the dense range
+        map<LENGTH, CNT> lengthMap;            // lengths out of the dense range
+#ifdef PHASE_TIMING
+        PHASE_COUNTERS phases;
+#endif
 };
 
-bool sign_extended(UINT64 value, UINT8 bit_size);
-bool zero_extended(UINT64 value, UINT8 bit_size);
+bool sign_extended(UINT64 value, UINT8 bit_size) {
+    UINT64 max = (1ULL << (bit_size-1)) - 1;    // bit_size: 4 -> ...00000111
+    UINT64 min = ~max;                          // bit_size: 4 -> ...11111000
+    return (value <= max) | (value >= min);
+}
+
+bool zero_extended(UINT64 value, UINT8 bit_size) {
+    UINT64 max = (1ULL << (bit_size)) - 1;      // bit_size: 4 -> ...00001111
+    return (value <= max);
+}
 
 //--------------------------------------------------------------------
 #endif /* __COMMON_HH__ */
@@ -0,0 +1,585 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+// vsc driver for one line size
+// : included by lsize*.cc with LSIZE and LSIZE_NS defined. The compressors
+//   are pulled into LSIZE_NS, so every system header they use must be
+//   included here first (outside of the namespace).
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <map>
+#include <list>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <zlib.h>
+#include <time.h>
+#include <sys/file.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
+#include "vsc.hh"
+
+namespace LSIZE_NS {
+
+#include "common.hh"
+#include "BPCompressor.hh"
+#include "BDICompressor.hh"
+#include "CPackCompressor.hh"
+#include "FPCompressor.hh"
+#include "BPCSweep.hh"
+#include "MappedFile.hh"
+#include "StreamReader.hh"
+#include "CompressorRegistry.hh"
+#include "PagePacker.hh"
+#include "TierSimulator.hh"
+#include "PageDedup.hh"
+#include "Progress.hh"
+#include "PageSampler.hh"
+
+// input snapshot; lines are numbered continuously across all inputs
+typedef struct {
+    const char *name;
+    CNT lines;          // unknown for streams
+    bool stream;
+} LINE_RANGE;
+
+// lines per stream read (both buffers are this size)
+#define STREAM_BATCH_PAGES 256
+
+// packed sizes (in bits) of a page range: one per compressor, then the
+// per-line and per-page best-of oracles
+#define ORACLE_LINE(n)  (n)
+#define ORACLE_PAGE(n)  ((n)+1)
+// then the page counts of the zero / duplicate filter
+#define ZERO_PAGES(n)   ((n)+2)
+#define DUP_PAGES(n)    ((n)+3)
+#define UNIQUE_PAGES(n) ((n)+4)
+// and the result cache lookups (one per page and cached compressor)
+#define CACHE_HITS(n)   ((n)+5)
+#define CACHE_MISSES(n) ((n)+6)
+#define PAGE_COUNTS(n)  ((n)+7)
+
+// compresses pages [first_page, last_page) with every compressor
+// : each line is read once and handed to all compressors
+// : the line before first_page seeds the compressors, so chunks compressed
+//   independently add up to exactly the serial result
+// : streams are read to their end, so inputs holding one are compressed
+//   in a single serial pass; *lines_read returns the lines seen and
+//   *read_error is set if a stream could not be read to its end
+// : packers[c] lays out the pages of comps[c] and counts their metadata
+// : with dedup, zero and duplicate pages are not compressed and take no
+//   space; the compressors are seeded with their last line instead
+// : with a result cache, a whole page is looked up (under configs[c], 0 if
+//   comps[c] is not cached) before comps[c] compresses it and stored after;
+//   on a hit the compressor is seeded with the page's last line
+// : progress (if not NULL) is this worker's shard, updated once per page
+vector<CNT> compressPages(const vector<Compressor *> &comps, vector<PagePacker> &packers, PageDedup *dedup, ResultCache *cache, const vector<UINT64> &configs, PROGRESS_SHARD *progress, const vector<LINE_RANGE> &inputs, CNT first_page, CNT last_page, int block_frag, int page_frag, bool populate, CNT *lines_read = NULL, bool *read_error = NULL) {
+    CNT begin = first_page*LINE_PER_PAGE;
+    CNT end = last_page*LINE_PER_PAGE;
+    CNT line_no = (begin>0) ? begin-1 : 0;
+    unsigned n = comps.size();
+    vector<CNT> accumCnt(PAGE_COUNTS(n), 0ull);
+    vector<LENGTH> size(n*LINE_PER_PAGE);
+    CACHELINE_DATA prev_line;       // the line before the lines processed
+    memset(&prev_line, 0, sizeof(prev_line));
+
+    // lines: consecutive lines starting at line_no; compressed a page
+    // (or what the input holds of it) at a time per compressor
+    auto process = [&](CACHELINE_DATA *lines, CNT count) {
+        CNT i = 0;
+        if ((count>0) && (line_no < begin)) {
+            for (unsigned c=0; c<n; c++) {
+                comps[c]->seed(&lines[0]);
+            }
+            line_no++;
+            i++;
+        }
+        while (i < count) {
+            int lineno = line_no % LINE_PER_PAGE;
+            if ((dedup!=NULL) && (lineno==0) && (count-i >= LINE_PER_PAGE)) {
+                CNT copy = NO_COPY;
+                int kind = dedup->classify(&lines[i], line_no/LINE_PER_PAGE, &copy);
+                if (kind!=PAGE_UNIQUE) {
+                    for (unsigned c=0; c<n; c++) {
+                        comps[c]->seed(&lines[i+LINE_PER_PAGE-1]);
+                        packers[c].skip(copy);
+                    }
+                    accumCnt[(kind==PAGE_ZERO) ? ZERO_PAGES(n) : DUP_PAGES(n)]++;
+                    if (progress!=NULL) {
+                        progress->pages.fetch_add(1, memory_order_relaxed);
+                    }
+                    line_no += LINE_PER_PAGE;
+                    i += LINE_PER_PAGE;
+                    continue;
+                }
+                accumCnt[UNIQUE_PAGES(n)]++;
+            }
+            CNT batch = min(count-i, (CNT) (LINE_PER_PAGE-lineno));
+            bool whole = (cache!=NULL) && (batch==LINE_PER_PAGE);
+            PAGE_KEY key;
+            if (whole) {
+                key = ResultCache::pageKey(&lines[i], (i>0) ? &lines[i-1] : &prev_line);
+            }
+            for (unsigned c=0; c<n; c++) {
+                LENGTH *out = &size[c*LINE_PER_PAGE+lineno];
+                if (whole && (configs[c]!=0)) {
+                    if (cache->lookup(key, configs[c], out)) {
+                        comps[c]->seed(&lines[i+LINE_PER_PAGE-1]);
+                        accumCnt[CACHE_HITS(n)]++;
+                        continue;
+                    }
+                    accumCnt[CACHE_MISSES(n)]++;
+                }
+                comps[c]->compressLines(&lines[i], batch, line_no*(LSIZE/8), out);
+                if (whole && (configs[c]!=0)) {
+                    cache->insert(key, configs[c], out);
+                }
+            }
+            line_no += batch;
+            i += batch;
+            if (line_no % LINE_PER_PAGE == 0) {
+                unsigned best[LINE_PER_PAGE];
+                for (int l=0; l<LINE_PER_PAGE; l++) {
+                    best[l] = LSIZE;
+                    for (unsigned c=0; c<n; c++) {
+                        best[l] = min(best[l], size[c*LINE_PER_PAGE+l]);
+                    }
+                }
+                int best_page = PAGE_SIZE*8;
+                for (unsigned c=0; c<n; c++) {
+                    int page = packers[c].pack(&size[c*LINE_PER_PAGE]);
+                    accumCnt[c] += page;
+                    best_page = min(best_page, page);
+                }
+                accumCnt[ORACLE_LINE(n)] += packPage(best, block_frag, page_frag);
+                accumCnt[ORACLE_PAGE(n)] += best_page;
+                if (progress!=NULL) {
+                    progress->pages.fetch_add(1, memory_order_relaxed);
+                    progress->bits.store(accumCnt[0], memory_order_relaxed);
+                }
+            }
+        }
+        if (i>0) {
+            prev_line = lines[i-1];
+        }
+    };
+
+    CNT first_line = 0;     // of *f
+    for (auto f = inputs.cbegin(); (f != inputs.cend()) && (line_no < end); ++f) {
+        if (f->stream) {
+            assert(begin==0);
+            StreamReader reader(f->name, STREAM_BATCH_PAGES*PAGE_SIZE, LSIZE/8);
+            UINT8 *buf;
+            size_t bytes;
+            while ((buf = reader.next(&bytes))!=NULL) {
+                process((CACHELINE_DATA *) buf, bytes/(LSIZE/8));
+            }
+            if (reader.failed()) {
+                fprintf(stderr, "error reading %s: %s\n", f->name, reader.failure());
+                if (read_error!=NULL) {
+                    *read_error = true;
+                }
+                break;
+            }
+            first_line = line_no;
+            continue;
+        }
+        if (line_no >= first_line + f->lines) {
+            first_line += f->lines;
+            continue;
+        }
+        CNT first = line_no - first_line;
+        CNT count = min(f->lines - first, end - line_no);
+        first_line += f->lines;
+
+        MappedFile map(f->name, (off_t) first*(LSIZE/8), (size_t) count*(LSIZE/8), populate);
+        CACHELINE_DATA *lines = map.lines();
+        if (lines!=NULL) {      // zero-copy
+            process(lines, count);
+        } else {
+            FILE *fd = fopen(f->name, "rb");
+            assert(fd!=NULL);
+            fseeko(fd, (off_t) first*(LSIZE/8), SEEK_SET);
+            CACHELINE_DATA buf[LINE_PER_PAGE];
+            while (count > 0) {
+                CNT got = fread(buf, LSIZE/8, min(count, (CNT) LINE_PER_PAGE), fd);
+                process(buf, got);
+                if (got==0) {
+                    break;
+                }
+                count -= got;
+            }
+            fclose(fd);
+        }
+    }
+    if (lines_read!=NULL) {
+        *lines_read = line_no;
+    }
+    return accumCnt;
+}
+
+// compresses a sample of the pages of every input (PageSampler.hh) and
+// prints each compressor's estimated ratio with its 95% confidence interval
+// and the estimated share of every packed page size
+// : only the sampled pages are read; each one is compressed from the state
+//   of a fresh run (compressors seeded with a zero line), since the line
+//   before it is not read
+// : page p of an input is addressed as page p after the whole pages of the
+//   inputs before it, so it is page-aligned even when one of them ends
+//   mid-page (BPSSweepDW takes a line's place in its page from the address)
+int compressSampled(const vector<Compressor *> &comps, const vector<LINE_RANGE> &inputs, double rate, UINT64 seed, int block_frag, int page_frag, const string &suffix) {
+    unsigned n = comps.size();
+    vector<SampleEstimate> estimates(n);
+    CACHELINE_DATA zero_line;
+    memset(&zero_line, 0, sizeof(zero_line));
+    CACHELINE_DATA page[LINE_PER_PAGE];
+    LENGTH size[LINE_PER_PAGE];
+    CNT total_pages = 0ull;
+    for (unsigned f=0; f<inputs.size(); f++) {
+        CNT pages = inputs[f].lines/LINE_PER_PAGE;
+        vector<CNT> sample;
+        samplePages(pages, rate, seed*1000003+f, sample);
+        PageReader reader(inputs[f].name);
+        if (!reader.ok()) {
+            fprintf(stderr, "cannot open %s\n", inputs[f].name);
+            return 1;
+        }
+        for (unsigned c=0; c<n; c++) {
+            estimates[c].addInput(pages);
+        }
+        for (auto p = sample.cbegin(); p != sample.cend(); ++p) {
+            if (!reader.read((off_t) *p*PAGE_SIZE, page)) {
+                fprintf(stderr, "error reading %s\n", inputs[f].name);
+                return 1;
+            }
+            for (unsigned c=0; c<n; c++) {
+                comps[c]->seed(&zero_line);
+                comps[c]->compressLines(page, LINE_PER_PAGE, (total_pages+*p)*PAGE_SIZE, size);
+                estimates[c].addPage(packPage(size, block_frag, page_frag));
+            }
+        }
+        for (unsigned c=0; c<n; c++) {
+            estimates[c].closeInput();
+        }
+        total_pages += pages;
+    }
+
+    double uncompressed = (double) total_pages*PAGE_SIZE*8;
+    for (unsigned c=0; c<n; c++) {
+        string name = comps[c]->getName() + suffix;
+        double variance;
+        double total = estimates[c].getTotal(&variance);
+        double half = 1.96*sqrt(variance);
+        printf("%s_%d_%d Sampled %lld of %lld pages Est_Comp_Ratio: %.2f ", name.c_str(), block_frag, page_frag,
+               estimates[c].getSampled(), total_pages, uncompressed/total);
+        if (estimates[c].getSampled()<2) {
+            printf("95%% CI: n/a \n");     // no variance from a single page
+        } else {
+            printf("95%% CI: %.2f - %.2f \n", uncompressed/(total+half), uncompressed/max(total-half, 0.0));
+        }
+        printf("%s_%d_%d Page sizes:", name.c_str(), block_frag, page_frag);
+        const map<unsigned, double> &classes = estimates[c].getClasses();
+        for (auto it = classes.cbegin(); it != classes.cend(); ++it) {
+            printf(" %uB %.1f%%", it->first/8, it->second*100./total_pages);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int run(const vector<INPUT_FILE> &files, const RUN_OPTIONS &opts) {
+    vector<LINE_RANGE> inputs;
+    CNT total_lines = 0ull;
+    bool stream = false;
+    for (auto f = files.cbegin(); f != files.cend(); ++f) {
+        LINE_RANGE r = { f->name, (CNT) f->bytes/(LSIZE/8), f->stream };
+        inputs.push_back(r);
+        total_lines += r.lines;
+        stream |= f->stream;
+    }
+    CNT total_pages = total_lines/LINE_PER_PAGE;
+    int jobs = opts.jobs;
+    if (stream && (jobs>1)) {
+        // the page count is known only after the streams are read
+        fprintf(stderr, "streamed input: -j %d ignored\n", jobs);
+        jobs = 1;
+    }
+    bool populate = opts.populate;
+
+    // compressors
+    loaded_code_tables.clear();
+    if ((opts.code_tables!=NULL) && !bpcLoadTables(opts.code_tables, loaded_code_tables)) {
+        fprintf(stderr, "cannot read code tables from %s\n", opts.code_tables);
+        return 1;
+    }
+    vector<Compressor *> comps;
+    for (auto spec = opts.specs.cbegin(); spec != opts.specs.cend(); ++spec) {
+        Compressor *comp = createCompressor(*spec);
+        if (comp==NULL) {
+            fprintf(stderr, "unknown compressor spec '%s', expected one of\n%s", spec->c_str(), COMPRESSOR_SPECS);
+            return 1;
+        }
+        comps.push_back(comp);
+    }
+    if (comps.empty()) {
+        comps.push_back(new BPSCompressor64("BPC64_5", 2, 4, 10, 2));
+    }
+    unsigned n = comps.size();
+    int block_frag = opts.block_frag;
+    int page_frag = 0;
+    for (unsigned c=0; c<n; c++) {
+        applyCodeTable(comps[c]);
+        if (BPSSweepDW *sweep = dynamic_cast<BPSSweepDW *>(comps[c])) {
+            sweep->setPacking(block_frag, page_frag);
+        }
+    }
+    CNT psize=4096;
+
+    string suffix;
+    if (opts.tag) {
+        ostringstream line_bytes;
+        line_bytes << "_" << (LSIZE/8) << "B";
+        suffix = line_bytes.str();
+    }
+    if (opts.sample>0) {
+        if ((jobs>1) || opts.dedup || opts.layout || (opts.trace!=NULL) || (opts.train!=NULL)) {
+            fprintf(stderr, "sampled run: -j, -z, -m, -t and -g ignored\n");
+        }
+        int status = compressSampled(comps, inputs, opts.sample, opts.seed, block_frag, page_frag, suffix);
+        for (unsigned c=0; c<n; c++) {
+            delete comps[c];
+        }
+        return status;
+    }
+
+    vector<CNT> accumCnt(PAGE_COUNTS(n), 0ull);
+    vector<PagePacker> packers(n, PagePacker(block_frag, page_frag));
+    vector<TRACE_ACCESS> trace;
+    if (opts.trace!=NULL) {
+        if (!loadTrace(opts.trace, trace)) {
+            fprintf(stderr, "cannot read trace %s\n", opts.trace);
+            return 1;
+        }
+        for (unsigned c=0; c<n; c++) {
+            packers[c].keepPages();
+        }
+    }
+    if (opts.layout) {
+        for (unsigned c=0; c<n; c++) {
+            packers[c].layoutPages();
+        }
+    }
+    PageDedup *dedup = opts.dedup ? new PageDedup() : NULL;
+    // one cache file per line size; -g needs every page's symbol counts
+    ResultCache *cache = NULL;
+    vector<UINT64> configs(n, 0ull);
+    if ((opts.result_cache!=NULL) && (opts.train!=NULL)) {
+        fprintf(stderr, "training code tables: -C ignored\n");
+    } else if (opts.result_cache!=NULL) {
+        ostringstream path;
+        path << opts.result_cache << "." << (LSIZE/8) << "B";
+        cache = new ResultCache();
+        for (unsigned c=0; c<n; c++) {
+            configs[c] = resultCacheConfig(comps[c]);
+        }
+        // streamed inputs have no page count here: the table grows as they fill it
+        if (!cache->open(path.str().c_str(), total_pages*n)) {
+            fprintf(stderr, "cannot open result cache %s\n", path.str().c_str());
+            delete cache;
+            return 1;
+        }
+    }
+    vector<PROGRESS_SHARD> shards(jobs);
+    ProgressMonitor *monitor = opts.progress ? new ProgressMonitor(shards.data(), jobs, stream ? 0 : total_pages) : NULL;
+    if (jobs==1) {
+        for (unsigned c=0; c<n; c++) {
+            comps[c]->reset();
+        }
+        CNT last_page = stream ? ((~0ull)/LINE_PER_PAGE) : total_pages;
+        bool read_error = false;
+        accumCnt = compressPages(comps, packers, dedup, cache, configs, opts.progress ? &shards[0] : NULL, inputs, 0, last_page, block_frag, page_frag, populate, &total_lines, &read_error);
+        if (read_error) {
+            // no report on the part of an input that could be read
+            delete monitor;
+            delete cache;
+            delete dedup;
+            for (unsigned c=0; c<n; c++) {
+                delete comps[c];
+            }
+            return 1;
+        }
+        total_pages = total_lines/LINE_PER_PAGE;
+    } else {
+        if (dedup!=NULL) {
+            // the first page with a content is found in page order by a
+            // serial pass without compressors, whose results the workers read
+            vector<Compressor *> none;
+            vector<PagePacker> no_packers;
+            dedup->record();
+            compressPages(none, no_packers, dedup, NULL, configs, NULL, inputs, 0, total_pages, block_frag, page_frag, populate);
+            dedup->replay();
+        }
+        // contiguous page chunks, one set of compressor instances per worker
+        vector<thread> workers;
+        vector<vector<Compressor *> > chunk_comps(jobs);
+        vector<vector<CNT> > chunk_cnt(jobs);
+        vector<vector<PagePacker> > chunk_packers(jobs, packers);
+        for (int j=0; j<jobs; j++) {
+            for (unsigned c=0; c<n; c++) {
+                chunk_comps[j].push_back(comps[c]->clone());
+                chunk_comps[j][c]->reset();
+            }
+            CNT first_page = total_pages*j/jobs;
+            CNT last_page = total_pages*(j+1)/jobs;
+            workers.push_back(thread([&, j, first_page, last_page]() {
+                chunk_cnt[j] = compressPages(chunk_comps[j], chunk_packers[j], dedup, cache, configs, opts.progress ? &shards[j] : NULL, inputs, first_page, last_page, block_frag, page_frag, populate);
+            }));
+        }
+        for (int j=0; j<jobs; j++) {
+            workers[j].join();
+            for (unsigned c=0; c<PAGE_COUNTS(n); c++) {
+                accumCnt[c] += chunk_cnt[j][c];
+            }
+            for (unsigned c=0; c<n; c++) {
+                packers[c].merge(chunk_packers[j][c]);
+                comps[c]->mergeStatistics(*chunk_comps[j][c]);
+                delete chunk_comps[j][c];
+            }
+        }
+    }
+    delete monitor;
+
+    CNT totalUncomp = total_pages*psize;
+    for (unsigned c=0; c<n+2; c++) {
+        // oracles only when there is something to choose from
+        if ((c>=n) && (n==1)) {
+            break;
+        }
+        string name = (c<n) ? comps[c]->getName() : (c==ORACLE_LINE(n)) ? "Oracle-Line" : "Oracle-Page";
+        name += suffix;
+        printf("%s_%d_%d Total Bytes %lld Comp_Ratio: %.2f \n", name.c_str(), block_frag, page_frag, totalUncomp, (float)(totalUncomp*8)/(float)accumCnt[c]);
+    }
+    if (dedup!=NULL) {
+        // pages cut short of a full page at the end of an input are compressed as usual
+        printf("Pages%s Zero %lld Duplicate %lld Unique %lld \n", suffix.c_str(), accumCnt[ZERO_PAGES(n)], accumCnt[DUP_PAGES(n)], accumCnt[UNIQUE_PAGES(n)]);
+    }
+    if (cache!=NULL) {
+        printf("Cache%s Hits %lld Misses %lld Entries %lld \n", suffix.c_str(), accumCnt[CACHE_HITS(n)], accumCnt[CACHE_MISSES(n)], cache->getCount());
+        delete cache;
+    }
+#ifdef PHASE_TIMING
+    for (unsigned c=0; c<n; c++) {
+        comps[c]->printPhases(stdout);
+    }
+#endif
+    for (unsigned c=0; c<n; c++) {
+        if (const BPSSweepDW *sweep = dynamic_cast<const BPSSweepDW *>(comps[c])) {
+            sweep->printSweep(stdout, totalUncomp*8);
+        }
+    }
+    if (opts.layout) {
+        // in-page line-offset metadata: size of the built table, cost of
+        // locating a line (averaged over the lookups of every line of the
+        // packed pages) and the ratio once the table is stored in the page
+        const PagePacker &p = packers[0];
+        printf("Layout size-codes: %u B/page, %.1f adds + %.1f B read per lookup\n", (p.codeMetadataBits()+7)/8, p.codeLookupAdds(), p.codeLookupBits()/8);
+        printf("Layout end-offsets: %u B/page, 0 adds + %.1f B read per lookup\n", (p.endMetadataBits()+7)/8, p.endLookupBits()/8);
+        for (unsigned c=0; c<n; c++) {
+            string name = comps[c]->getName() + suffix;
+            printf("%s_%d_%d size-codes Comp_Ratio: %.2f end-offsets Comp_Ratio: %.2f \n", name.c_str(), block_frag, page_frag,
+                   (float)(totalUncomp*8)/(float)packers[c].getCodePages(), (float)(totalUncomp*8)/(float)packers[c].getEndPages());
+        }
+    }
+    delete dedup;
+    if (opts.train!=NULL) {
+        // code tables from this run's symbol counts, added to those of the
+        // line sizes before; the last line size writes them all
+        for (unsigned c=0; c<n; c++) {
+            BPC_CODE_TABLE table;
+            if (trainCodeTable(comps[c], &table)) {
+                const unsigned char *bytes = (const unsigned char *) &table;
+                opts.trained->push_back(make_pair(bpcTableName(comps[c]->getName()), vector<unsigned char>(bytes, bytes+sizeof(table))));
+            }
+        }
+    }
+    if ((opts.train!=NULL) && opts.train_write) {
+        vector<pair<string, BPC_CODE_TABLE> > tables;
+        for (auto it = opts.trained->cbegin(); it != opts.trained->cend(); ++it) {
+            BPC_CODE_TABLE table;
+            assert(it->second.size()==sizeof(table));
+            memcpy(&table, it->second.data(), sizeof(table));
+            tables.push_back(pair<string, BPC_CODE_TABLE>(it->first, table));
+        }
+        FILE *fd = fopen(opts.train, "w");
+        if (fd==NULL) {
+            fprintf(stderr, "cannot write %s\n", opts.train);
+            return 1;
+        }
+        bpcWriteTables(fd, tables);
+        fclose(fd);
+        fprintf(stderr, "%u code table(s) written to %s\n", (unsigned) tables.size(), opts.train);
+    }
+    if (opts.trace!=NULL) {
+        // replay the trace against each compressor's page store
+        for (unsigned c=0; c<n; c++) {
+            TierSimulator sim(packers[c].getPages(), opts.cache_pages);
+            for (auto a = trace.cbegin(); a != trace.cend(); ++a) {
+                sim.access(*a);
+            }
+            ostringstream name;
+            name << comps[c]->getName() << suffix << "_" << block_frag << "_" << page_frag;
+            sim.print(stdout, name.str());
+        }
+    }
+    for (unsigned c=0; c<n; c++) {
+        delete comps[c];
+    }
+    return 0;
+}
+
+}   // namespace LSIZE_NS
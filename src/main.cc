@@ -25,126 +25,155 @@
 //           : Esha Choukse
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-#include <math.h>
-#include <map>
-#include <list>
-
-#include "common.hh"
-#include "BPCompressor.hh"
-#include "BDICompressor.hh"
-#include "CPackCompressor.hh"
-#include "FPCompressor.hh"
-
 #include <sys/stat.h>
-#define PAGE_SIZE 4096
-#define LINE_PER_PAGE (PAGE_SIZE*8)/LSIZE
+#include <unistd.h>
+#include <vector>
 
-//usage:./vsc 1 cactusADM/Comppt_dump/memory/user/*
-//1 : block_frag type
-int main(int argc, char **argv)
-{
-    assert(argc>1);
+#include "vsc.hh"
 
-    int i;
-    // compressors
-    list<Compressor *> comps;
-    comps.push_back(new BPSCompressor64("BPC64_5", 2, 4, 10, 2));
-    for (auto it = comps.cbegin(); it != comps.cend(); ++it) {
-        //Per compressor outer loop
-        CNT total_block_cnt = 0ull;
+using namespace std;
 
-        int bsizeindex = 0;
+typedef int (*RUN_FUNC)(const vector<INPUT_FILE> &inputs, const RUN_OPTIONS &opts);
 
-        (*it)->reset();
-        CNT accumCnt[3][2] = {{0ull}};
-        CNT totalUncomp = 0ull;
-        CNT totalOverflow=0ull;
-        CNT psize=4096;
-        int block_frag = (int)atoi(argv[1]);
-        //cout << block_frag << endl;
-        int page_frag = 0;
+#define LSIZE_DRIVER(bits) { bits, lsize_##bits::run },
+static const struct { int bits; RUN_FUNC run; } drivers[] = { LSIZE_LIST(LSIZE_DRIVER) };
 
-        // phase 1:
-        for (int arg_idx = 2; arg_idx < argc; arg_idx++) {
-            char bench[256];
-            int i;
-            int pagenum=0;
-            int start_pos = 0, end_pos = strlen(argv[arg_idx])-1;
-            for (i=strlen(argv[arg_idx])-1;i>=0; i--) {
-                if (argv[arg_idx][i]=='/') {
-                    start_pos = i+1;
-                    break;
-                }
-            }
-            for (i=0; i<=end_pos - start_pos; i++) {
-                bench[i] = argv[arg_idx][start_pos+i];
+//usage:./vsc [-j threads] [-v] [-z] [-m] [-t trace [-k cache pages]] [-g|-T tables] [-s percent[:seed]] [-C cache] [-l line bytes] [-c compressor]... 1 cactusADM/Comppt_dump/memory/user/*
+//1 : block_frag type
+//-j: compress page chunks in parallel (same result as serial)
+//-p: prefault the mapped inputs (MAP_POPULATE)
+//-v: pages done, GB/s, ratio so far and ETA on stderr every second
+//-l: line size in bytes (32/64/128, default 64); repeat to sweep sizes in one run
+//-c: compressor spec (CompressorRegistry.hh); repeat to compress every line
+//    with all of them in one pass, plus per-line / per-page best-of totals
+//-z: zero and duplicate pages are counted, not compressed (PageDedup.hh)
+//-m: line-offset metadata of the packed pages (PagePacker.hh)
+//-t: replay a memory-access trace against the compressed pages, with -k
+//    decompressed pages cached in front (TierSimulator.hh)
+//-g: train BPC code tables on the inputs and write them as a header
+//-T: load trained BPC code tables (BPCCodeTable.hh) at start-up
+//-s: compress a stratified random sample of percent of the pages of each
+//    input and estimate the ratio with a confidence interval (PageSampler.hh)
+//inputs: files, .gz dumps, named pipes or - for stdin
+int main(int argc, char **argv)
+{
+    RUN_OPTIONS opts;
+    opts.jobs = 1;
+    opts.populate = false;
+    opts.progress = false;
+    opts.block_frag = 0;
+    opts.tag = false;
+    opts.dedup = false;
+    opts.layout = false;
+    opts.trace = NULL;
+    opts.cache_pages = 256;
+    opts.train = NULL;
+    TRAINED_TABLES trained;
+    opts.trained = &trained;
+    opts.train_write = false;
+    opts.code_tables = NULL;
+    opts.sample = 0.0;
+    opts.seed = 1;
+    opts.result_cache = NULL;
+    vector<int> line_bits;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:pvl:c:zmt:k:g:T:s:C:")) != -1) {
+        if (opt=='j') {
+            opts.jobs = atoi(optarg);
+        } else if (opt=='p') {
+            opts.populate = true;
+        } else if (opt=='v') {
+            opts.progress = true;
+        } else if (opt=='l') {
+            line_bits.push_back(atoi(optarg)*8);
+        } else if (opt=='c') {
+            opts.specs.push_back(optarg);
+        } else if (opt=='z') {
+            opts.dedup = true;
+        } else if (opt=='m') {
+            opts.layout = true;
+        } else if (opt=='t') {
+            opts.trace = optarg;
+        } else if (opt=='k') {
+            opts.cache_pages = atoi(optarg);
+        } else if (opt=='g') {
+            opts.train = optarg;
+        } else if (opt=='T') {
+            opts.code_tables = optarg;
+        } else if (opt=='s') {
+            double percent;
+            if ((sscanf(optarg, "%lf:%llu", &percent, &opts.seed)<1) || (percent<=0) || (percent>100)) {
+                fprintf(stderr, "-s expects a percent of pages in (0, 100], optionally :seed\n");
+                return 1;
             }
-            bench[i] = '\0';
-            struct stat st;
-            stat(argv[arg_idx], &st);
-            //CNT psize = st.st_size;
-            FILE *fd = fopen(argv[arg_idx], "rb");
-            CACHELINE_DATA line;
-            CNT benchaccumCnt[3][2] = {{0ull}};
-            UINT64 line_addr;
-            int pageno = 0;
-            unsigned size[LINE_PER_PAGE];
-
-
-            while (fread(&line, LSIZE/8, 1, fd)==1) {
-                total_block_cnt++;
-                if (total_block_cnt%1000000==0) {
-                    //printf("Processing %lld\n", total_block_cnt);
-                }
-                int lineno = (total_block_cnt-1) % (LINE_PER_PAGE);
-                size[lineno] = (*it)->compressLine(&line, line_addr);
+            opts.sample = percent/100;
+        } else if (opt=='C') {
+            opts.result_cache = optarg;
+        } else {
+            return 1;
+        }
+    }
+    assert(argc>optind);
+    assert(opts.jobs>0);
+    opts.block_frag = (int)atoi(argv[optind]);
+    opts.tag = !line_bits.empty();
+    if (line_bits.empty()) {
+        line_bits.push_back(512);
+    }
 
-                if(lineno==LINE_PER_PAGE-1) {
-                    pageno++;
-                    int min_page=PAGE_SIZE*8; //Uncompressed page size
-                    int totallen=0;
-                    for(int lineid=0; lineid<LINE_PER_PAGE; lineid++) {
-                        for (unsigned i=0; i<8; i++) {
-                            if(size[lineid] <= block_sizes[block_frag][i]) {
-                                totallen+=block_sizes[block_frag][i];
-                                size[lineid] = block_sizes[block_frag][i];
-                                break;
-                            }
-                            if(i== 7){
-                                totallen+=block_sizes[block_frag][i];
-                                size[lineid] = block_sizes[block_frag][i];
-                            }
-                        }
-                        //cout << " " <<size[lineid];
-                    }
-                    if(totallen<min_page)
-                        min_page=totallen;	
-                    if(min_page!=0){
-                        //THIS STEP IS FOR PAGE PACKING
-                        int page_pack=1;
-                        if (page_pack){
-                            for(int i=0; i<8; i++) {
-                                if(min_page <= page_sizes[page_frag][i]){	
-                                    min_page = page_sizes[page_frag][i];
-                                    break;
-                                }
-                            }
-                        }
-                    }
+    // inputs
+    // "-" (stdin), pipes and .gz dumps are streamed instead of mapped
+    vector<INPUT_FILE> inputs;
+    bool once = false;      // an input that can be read only once
+    bool stream = false;
+    for (int arg_idx = optind+1; arg_idx < argc; arg_idx++) {
+        const char *name = argv[arg_idx];
+        size_t len = strlen(name);
+        INPUT_FILE f = { name, 0ull, false };
+        struct stat st;
+        if (strcmp(name, "-")==0) {
+            f.stream = true;
+            once = true;
+        } else if (stat(name, &st)!=0) {
+            fprintf(stderr, "cannot open %s\n", name);
+            return 1;
+        } else if (!S_ISREG(st.st_mode)) {
+            f.stream = true;
+            once = true;
+        } else if ((len>3) && (strcmp(name+len-3, ".gz")==0)) {
+            f.stream = true;
+        } else {
+            f.bytes = (unsigned long long) st.st_size;
+        }
+        stream |= f.stream;
+        inputs.push_back(f);
+    }
+    if ((opts.sample>0) && stream) {
+        fprintf(stderr, "sampling seeks to the sampled pages: streamed inputs cannot be sampled\n");
+        return 1;
+    }
+    if (once && (line_bits.size()>1)) {
+        fprintf(stderr, "stdin / pipe inputs can be read only once: give a single -l\n");
+        return 1;
+    }
 
-                    accumCnt[block_frag][page_frag]+=min_page;
-                    benchaccumCnt[block_frag][page_frag]+=min_page;
-                    pagenum++;
-                    totalUncomp+=psize;
-                }
+    for (auto bits = line_bits.cbegin(); bits != line_bits.cend(); ++bits) {
+        RUN_FUNC run = NULL;
+        for (unsigned i=0; i<sizeof(drivers)/sizeof(drivers[0]); i++) {
+            if (drivers[i].bits==*bits) {
+                run = drivers[i].run;
             }
-
-//            printf("%s %lld %lld %.2f\n", bench, psize, benchaccumCnt[block_frag][page_frag]/8, (float)(psize*8)/(float)benchaccumCnt[block_frag][page_frag]);
-            fclose(fd);
         }
-        CNT totalPages=totalUncomp/psize;
-        printf("%s_%d_%d Total Bytes %lld Comp_Ratio: %.2f \n", (*it)->getName().c_str(), block_frag, page_frag, totalUncomp, (float)(totalUncomp*8)/(float)accumCnt[block_frag][page_frag]);
+        if (run==NULL) {
+            fprintf(stderr, "unsupported line size %d B\n", *bits/8);
+            return 1;
+        }
+        opts.train_write = (bits+1 == line_bits.cend());
+        if (run(inputs, opts)!=0) {
+            return 1;
+        }
     }
 }
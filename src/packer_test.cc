@@ -0,0 +1,110 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <map>
+#include <vector>
+
+#include "common.hh"
+#include "PagePacker.hh"
+
+// page layout and line-offset metadata of PagePacker: the offset of every
+// line, found from the size codes and from the end offsets, is the one the
+// layout gave it, for every block / page size class set; build once per
+// LSIZE (make test)
+
+static UINT64 test_rand(UINT64 &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// compressed line sizes of a page: zero, incompressible, or any size
+static void makePage(UINT64 &state, int n, unsigned *size) {
+    for (int l=0; l<LINE_PER_PAGE; l++) {
+        switch (n%4) {
+            case 0:  size[l] = 0;                                    break;
+            case 1:  size[l] = LSIZE;                                break;
+            case 2:  size[l] = (test_rand(state)%4) ? 0 : LSIZE;     break;
+            default: size[l] = test_rand(state)%(LSIZE+1);
+        }
+    }
+}
+
+static int checkPacker(int block_frag, int page_frag) {
+    PagePacker packer(block_frag, page_frag);
+    packer.layoutPages();
+    UINT64 state = 0x9E3779B97F4A7C15ull + block_frag*2 + page_frag;
+    int errors = 0;
+    int packed = 0;
+    for (int n=0; n<2000; n++) {
+        unsigned size[LINE_PER_PAGE];
+        makePage(state, n, size);
+        int page = packer.pack(size);   // rounds size[]
+        packed += (page>0);
+        unsigned offset = 0;
+        for (int l=0; l<LINE_PER_PAGE; l++) {
+            unsigned adds, bits;
+            unsigned by_codes = packer.offsetByCodes(l, &adds, &bits);
+            unsigned by_ends = packer.offsetByEnds(l, &bits);
+            if ((packer.lineOffset(l)!=offset) || (by_codes!=offset) || (by_ends!=offset) || (adds!=(unsigned) l)) {
+                if (errors++<5) {
+                    printf("  frag %d/%d page %d line %d: offset %u, layout %u, codes %u, ends %u\n",
+                           block_frag, page_frag, n, l, offset, packer.lineOffset(l), by_codes, by_ends);
+                }
+            }
+            offset += size[l];
+        }
+        if (packer.lineOffset(LINE_PER_PAGE)!=offset) {
+            errors++;
+        }
+    }
+    // every line of every non-zero page located once
+    if ((packed==0) || (fabs(packer.codeLookupAdds()-(LINE_PER_PAGE-1)/2.0)>1e-9)
+        || (packer.codeMetadataBits()%LINE_PER_PAGE!=0) || (packer.endMetadataBits()%LINE_PER_PAGE!=0)) {
+        printf("  frag %d/%d: %d pages packed, %.2f adds per lookup, tables %u / %u bits\n", block_frag, page_frag,
+               packed, packer.codeLookupAdds(), packer.codeMetadataBits(), packer.endMetadataBits());
+        errors++;
+    }
+    printf("  block frag %d page frag %d %s (%u + %u B metadata)\n", block_frag, page_frag, (errors==0) ? "ok" : "FAILED",
+           (packer.codeMetadataBits()+7)/8, (packer.endMetadataBits()+7)/8);
+    return errors;
+}
+
+int main() {
+    printf("page layout, %d B lines, %d lines per page\n", LSIZE/8, LINE_PER_PAGE);
+    int errors = 0;
+    for (int block_frag=0; block_frag<3; block_frag++) {
+        for (int page_frag=0; page_frag<2; page_frag++) {
+            errors += checkPacker(block_frag, page_frag);
+        }
+    }
+    return (errors==0) ? 0 : 1;
+}
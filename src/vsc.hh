@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2020 SungKyunKwan University
+// Copyright (c) 2019 The University of Texas at Austin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author(s) : Jungrae Kim
+//           : Esha Choukse
+
+
+#ifndef __VSC_HH__
+#define __VSC_HH__
+
+#include <string>
+#include <vector>
+
+// BPC code tables trained by -g over every line size: table name and the
+// bytes of its BPC_CODE_TABLE (the same layout at every LSIZE)
+typedef std::vector<std::pair<std::string, std::vector<unsigned char> > > TRAINED_TABLES;
+
+// input snapshot
+typedef struct {
+    const char *name;
+    unsigned long long bytes;   // unknown (0) for streams
+    bool stream;                // stdin, pipe or .gz: read once, in order
+} INPUT_FILE;
+
+typedef struct {
+    int jobs;           // page chunks compressed in parallel
+    bool populate;      // prefault the mapped inputs
+    bool progress;      // print a progress line every second (stderr)
+    int block_frag;
+    bool tag;           // add the line size to the compressor names
+    bool dedup;         // zero / duplicate pages skip compression
+    bool layout;        // report the line-offset metadata of packed pages
+    const char *trace;  // memory-access trace to replay (TierSimulator.hh), or NULL
+    unsigned cache_pages; // decompressed pages cached in front of the tier
+    const char *train;  // write BPC code tables trained on the inputs, or NULL
+    TRAINED_TABLES *trained; // -g tables of the line sizes run so far
+    bool train_write;   // the last line size: write *trained to train
+    const char *code_tables; // BPC code tables to load (BPCCodeTable.hh), or NULL
+    double sample;      // fraction of the pages compressed (PageSampler.hh), 0 for all
+    unsigned long long seed; // of the page sample
+    const char *result_cache; // per-page result cache file prefix (ResultCache.hh), or NULL
+    std::vector<std::string> specs; // compressors (see CompressorRegistry.hh)
+} RUN_OPTIONS;
+
+// line sizes (in bits) with a prebuilt driver; each one is compiled from
+// driver.hh with its own LSIZE, so every loop bound stays a constant
+#define LSIZE_LIST(X)   X(256) X(512) X(1024)
+
+#define LSIZE_DECLARE(bits) \
+    namespace lsize_##bits { int run(const std::vector<INPUT_FILE> &inputs, const RUN_OPTIONS &opts); }
+LSIZE_LIST(LSIZE_DECLARE)
+
+#endif /* __VSC_HH__ */